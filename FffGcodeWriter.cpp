@@ -30,6 +30,19 @@ FffGcodeWriter::FffGcodeWriter(SettingsBase* settings_)
     }
 }
 
+bool FffGcodeWriter::setLayerPlanSnapshotFile(const char* filename)
+{
+    snapshot_file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!snapshot_file.is_open())
+    {
+        return false;
+    }
+    snapshot_writer.reset(new SnapshotWriter(snapshot_file));
+    snapshot_writer->writeHeader(layer_plans_snapshot_magic, layer_plans_snapshot_version);
+    layer_plan_buffer.setSnapshotWriter(snapshot_writer.get());
+    return true;
+}
+
 void FffGcodeWriter::writeGCode(SliceDataStorage& storage, TimeKeeper& time_keeper)
 {
     gcode.preSetup(storage.meshgroup);
@@ -109,6 +122,8 @@ void FffGcodeWriter::writeGCode(SliceDataStorage& storage, TimeKeeper& time_keep
     }
 
 
+    storage.freezeAllSettings(); // before the layers are planned in parallel
+
     const std::function<LayerPlan* (int)>& produce_item =
         [&storage, total_layers, this](int layer_nr)
         {
@@ -119,7 +134,7 @@ void FffGcodeWriter::writeGCode(SliceDataStorage& storage, TimeKeeper& time_keep
         [this, total_layers](LayerPlan* gcode_layer)
         {
             Progress::messageProgress(Progress::Stage::EXPORT, std::max(0, gcode_layer->getLayerNr()) + 1, total_layers);
-            layer_plan_buffer.handle(*gcode_layer, gcode);
+            layer_plan_buffer.handle(*gcode_layer);
         };
     const unsigned int max_task_count = OMP_MAX_ACTIVE_LAYERS_PROCESSED;
     GcodeLayerThreader<LayerPlan> threader(
@@ -134,6 +149,10 @@ void FffGcodeWriter::writeGCode(SliceDataStorage& storage, TimeKeeper& time_keep
     threader.run();
 
     layer_plan_buffer.flush();
+    if (snapshot_writer && !snapshot_writer->flush())
+    {
+        logWarning("Couldn't write the layer plans to the snapshot file.\n");
+    }
 
     Progress::messageProgressStage(Progress::Stage::FINISH, &time_keeper);
 
@@ -214,8 +233,8 @@ void FffGcodeWriter::findLayerSeamsForSpiralize(SliceDataStorage& storage, size_
 
     // we track the seam position for each layer and ensure that the seam position for next layer continues in the right direction
 
-    storage.spiralize_wall_outlines.reserve(total_layers);
-    storage.spiralize_seam_vertex_indices.reserve(total_layers);
+    storage.spiralize_wall_outlines.assign(total_layers, nullptr);
+    storage.spiralize_seam_vertex_indices.assign(total_layers, 0);
 
     int last_layer_nr = -1; // layer number of the last non-empty layer processed (for any extruder or mesh)
 
@@ -611,7 +630,7 @@ void FffGcodeWriter::processRaft(const SliceDataStorage& storage)
             current_extruder_nr = to_be_primed_extruder_nr;
         }
 
-        layer_plan_buffer.handle(gcode_layer, gcode);
+        layer_plan_buffer.handle(gcode_layer);
     }
 
     { // raft interface layer
@@ -666,7 +685,7 @@ void FffGcodeWriter::processRaft(const SliceDataStorage& storage)
         infill_comp.generate(raft_polygons, raftLines);
         gcode_layer.addLinesByOptimizer(raftLines, gcode_layer.configs_storage.raft_interface_config, SpaceFillType::Lines);
 
-        layer_plan_buffer.handle(gcode_layer, gcode);
+        layer_plan_buffer.handle(gcode_layer);
     }
     
     int layer_height = train->getSettingInMicrons("raft_surface_thickness");
@@ -724,7 +743,7 @@ void FffGcodeWriter::processRaft(const SliceDataStorage& storage)
         infill_comp.generate(raft_polygons, raft_lines);
         gcode_layer.addLinesByOptimizer(raft_lines, gcode_layer.configs_storage.raft_surface_config, SpaceFillType::Lines);
 
-        layer_plan_buffer.handle(gcode_layer, gcode);
+        layer_plan_buffer.handle(gcode_layer);
     }
 }
 
@@ -6,6 +6,7 @@
 
 
 #include <fstream>
+#include <memory>
 #include "utils/gettime.h"
 #include "utils/logoutput.h"
 #include "utils/NoCopy.h"
@@ -24,6 +25,7 @@
 
 
 #include "LayerPlanBuffer.h"
+#include "SnapshotStream.h"
 
 
 namespace cura 
@@ -62,6 +64,9 @@ private:
      */
     std::ofstream output_file;
 
+    std::ofstream snapshot_file; //!< The file to which the layer plans are written, see \ref setLayerPlanSnapshotFile
+    std::unique_ptr<SnapshotWriter> snapshot_writer; //!< Writes the layer plans to \ref snapshot_file, if it is set
+
     /*!
      * For each raft/filler layer, the extruders to be used in that layer in the order in which they are going to be used.
      * The first number is the first raft layer. Indexing is shifted compared to normal negative layer numbers for raft/filler layers.
@@ -117,6 +122,17 @@ public:
         gcode.setOutputStream(stream);
     }
 
+    /*!
+     * Also write the planned paths of each layer to a file, just before they are written to gcode.
+     * 
+     * The file is a snapshot of the layer plans of all mesh groups, see \ref LayerPlanSnapshot.
+     * It can be compared between versions of the engine, or be used to profile the gcode export of the same paths.
+     * 
+     * \param filename The file to write the layer plans to
+     * \return Whether the file could be opened
+     */
+    bool setLayerPlanSnapshotFile(const char* filename);
+
     /*!
      * Get the total extruded volume for a specific extruder in mm^3
      * 
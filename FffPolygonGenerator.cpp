@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <map> // multimap (ordered map allowing duplicate keys)
+#include <memory> // unique_ptr
 #include <fstream> // ifstream.good()
 
 #ifdef _OPENMP
@@ -39,20 +40,49 @@
 #include "progress/ProgressStageEstimator.h"
 #include "progress/ProgressEstimatorLinear.h"
 #include "settings/AdaptiveLayerHeights.h"
+#include "SliceCache.h"
+#include "utils/WavefrontScheduler.h"
 
 
 namespace cura
 {
 
+//! Keys of the mesh settings which are looked up for every layer.
+static const SettingKey alternate_extra_perimeter_key("alternate_extra_perimeter");
+static const SettingKey bottom_layers_key("bottom_layers");
+static const SettingKey fill_outline_gaps_key("fill_outline_gaps");
+static const SettingKey initial_layer_line_width_factor_key("initial_layer_line_width_factor");
+static const SettingKey ironing_enabled_key("ironing_enabled");
+static const SettingKey ironing_only_highest_layer_key("ironing_only_highest_layer");
+static const SettingKey support_enable_key("support_enable");
+static const SettingKey support_tree_enable_key("support_tree_enable");
+static const SettingKey wall_0_extruder_nr_key("wall_0_extruder_nr");
+static const SettingKey wall_0_inset_key("wall_0_inset");
+static const SettingKey wall_line_count_key("wall_line_count");
+static const SettingKey wall_line_width_0_key("wall_line_width_0");
+static const SettingKey wall_line_width_x_key("wall_line_width_x");
+static const SettingKey wall_x_extruder_nr_key("wall_x_extruder_nr");
+
 
 bool FffPolygonGenerator::generateAreas(SliceDataStorage& storage, MeshGroup* meshgroup, TimeKeeper& timeKeeper)
 {
-    if (!sliceModel(meshgroup, timeKeeper, storage))
+    std::unique_ptr<SliceCache> slice_cache;
+    if (!slice_cache_directory.empty())
+    {
+        slice_cache.reset(new SliceCache(slice_cache_directory, *this, *meshgroup)); // before slicing clears the meshes
+    }
+
+    if (!sliceModel(meshgroup, timeKeeper, storage, slice_cache.get()))
     {
         return false;
     }
 
-    slices2polygons(storage, timeKeeper);
+    slices2polygons(storage, timeKeeper, slice_cache.get());
+
+    if (slice_cache)
+    {
+        slice_cache->saveWalls();
+    }
 
     return true;
 }
@@ -73,7 +103,33 @@ unsigned int FffPolygonGenerator::getDraftShieldLayerCount(const unsigned int to
     }
 }
 
-bool FffPolygonGenerator::sliceModel(MeshGroup* meshgroup, TimeKeeper& timeKeeper, SliceDataStorage& storage) /// slices the model
+bool FffPolygonGenerator::sliceModel(MeshGroup* meshgroup, TimeKeeper& timeKeeper, SliceDataStorage& storage, SliceCache* slice_cache) /// slices the model
+{
+    if (!slice_cache)
+    {
+        return sliceModelUncached(meshgroup, timeKeeper, storage);
+    }
+
+    if (slice_cache->loadSlices(storage))
+    {
+        log("Loaded the slices from %s\n", slice_cache->getSlicesFileName().c_str());
+        meshgroup->clear(); // like after slicing
+        return true;
+    }
+
+    SettingsReadRecorder read_recorder; // the slices only depend on the settings read while slicing
+    if (!sliceModelUncached(meshgroup, timeKeeper, storage))
+    {
+        return false;
+    }
+    if (slice_cache->saveSlices(storage, read_recorder.getReadSettings()))
+    {
+        log("Stored the slices in %s\n", slice_cache->getSlicesFileName().c_str());
+    }
+    return true;
+}
+
+bool FffPolygonGenerator::sliceModelUncached(MeshGroup* meshgroup, TimeKeeper& timeKeeper, SliceDataStorage& storage)
 {
     Progress::messageProgressStage(Progress::Stage::SLICING, &timeKeeper);
 
@@ -263,8 +319,10 @@ bool FffPolygonGenerator::sliceModel(MeshGroup* meshgroup, TimeKeeper& timeKeepe
     return true;
 }
 
-void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper& time_keeper)
+void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper& time_keeper, SliceCache* slice_cache)
 {
+    storage.freezeAllSettings(); // before the layers are processed in parallel
+
     // compute layer count and remove first empty layers
     // there is no separate progress stage for removeEmptyFisrtLayer (TODO)
     unsigned int slice_layer_count = 0;
@@ -299,7 +357,7 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
     }
     for (unsigned int mesh_order_idx(0); mesh_order_idx < mesh_order.size(); ++mesh_order_idx)
     {
-        processBasicWallsSkinInfill(storage, mesh_order_idx, mesh_order, inset_skin_progress_estimate);
+        processBasicWallsSkinInfill(storage, mesh_order_idx, mesh_order, inset_skin_progress_estimate, slice_cache);
         Progress::messageProgress(Progress::Stage::INSET_SKIN, mesh_order_idx + 1, storage.meshes.size());
     }
 
@@ -317,10 +375,13 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
 
     Progress::messageProgressStage(Progress::Stage::SUPPORT, &time_keeper);
 
+    storage.startCachingLayerOutlines(); // the support looks at the outlines of each layer many times
     AreaSupport::generateOverhangAreas(storage);
     AreaSupport::generateSupportAreas(storage);
+    storage.invalidateLayerOutlines(true);
     TreeSupport tree_support_generator(storage);
     tree_support_generator.generateSupportAreas(storage);
+    storage.invalidateLayerOutlines(true);
 
     // we need to remove empty layers after we have processed the insets
     // processInsets might throw away parts if they have no wall at all (cause it doesn't fit)
@@ -334,6 +395,7 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
     if (storage.print_layer_count == 0)
     {
         log("Stopping process because there are no non-empty layers.\n");
+        storage.stopCachingLayerOutlines();
         return;
     }
 
@@ -343,6 +405,7 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
     storage.primeTower.generateGroundpoly(storage);
     storage.primeTower.generatePaths(storage);
     storage.primeTower.subtractFromSupport(storage);
+    storage.invalidateLayerOutlines(true);
 
     logDebug("Processing ooze shield\n");
     processOozeShield(storage);
@@ -358,6 +421,8 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
         processPlatformAdhesion(storage);
     }
 
+    storage.stopCachingLayerOutlines(); // the outlines aren't looked at repeatedly anymore
+
     logDebug("Processing gaps\n");
     processOutlineGaps(storage);
     processPerimeterGaps(storage);
@@ -374,12 +439,13 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
     AreaSupport::generateSupportInfillFeatures(storage);
 }
 
-void FffPolygonGenerator::processBasicWallsSkinInfill(SliceDataStorage& storage, unsigned int mesh_order_idx, std::vector<unsigned int>& mesh_order, ProgressStageEstimator& inset_skin_progress_estimate)
+void FffPolygonGenerator::processBasicWallsSkinInfill(SliceDataStorage& storage, unsigned int mesh_order_idx, std::vector<unsigned int>& mesh_order, ProgressStageEstimator& inset_skin_progress_estimate, SliceCache* slice_cache)
 {
     unsigned int mesh_idx = mesh_order[mesh_order_idx];
     SliceMeshStorage& mesh = storage.meshes[mesh_idx];
     size_t mesh_layer_count = mesh.layers.size();
-    if (mesh.getSettingBoolean("infill_mesh"))
+    const bool is_infill_mesh = mesh.getSettingBoolean("infill_mesh");
+    if (is_infill_mesh)
     {
         processInfillMesh(storage, mesh_order_idx, mesh_order);
     }
@@ -395,30 +461,6 @@ void FffPolygonGenerator::processBasicWallsSkinInfill(SliceDataStorage& storage,
     mesh_inset_skin_progress_estimator->nextStage(inset_estimator);
 
 
-    // walls
-    unsigned int processed_layer_count = 0;
-#pragma omp parallel for default(none) shared(mesh_layer_count, storage, mesh, inset_skin_progress_estimate, processed_layer_count) schedule(dynamic)
-    for (unsigned int layer_number = 0; layer_number < mesh.layers.size(); layer_number++)
-    {
-        logDebug("Processing insets for layer %i of %i\n", layer_number, mesh_layer_count);
-        processInsets(storage, mesh, layer_number);
-#ifdef _OPENMP
-        if (omp_get_thread_num() == 0)
-#endif
-        { // progress estimation is done only in one thread so that no two threads message progress at the same time
-            int _processed_layer_count;
-#pragma omp atomic read
-                _processed_layer_count = processed_layer_count;
-            double progress = inset_skin_progress_estimate.progress(_processed_layer_count);
-            Progress::messageProgress(Progress::Stage::INSET_SKIN, progress * 100, 100);
-        }
-#pragma omp atomic
-        processed_layer_count++;
-    }
-
-    ProgressEstimatorLinear* skin_estimator = new ProgressEstimatorLinear(mesh_layer_count);
-    mesh_inset_skin_progress_estimator->nextStage(skin_estimator);
-
     bool process_infill = mesh.getSettingInMicrons("infill_line_distance") > 0;
     if (!process_infill)
     { // do process infill anyway if it's modified by modifier meshes
@@ -437,16 +479,76 @@ void FffPolygonGenerator::processBasicWallsSkinInfill(SliceDataStorage& storage,
             }
         }
     }
-    // skin & infill
-//     Progress::messageProgressStage(Progress::Stage::SKIN, &time_keeper);
     int mesh_max_bottom_layer_count = 0;
     if (getSettingBoolean("magic_spiralize"))
     {
         mesh_max_bottom_layer_count = std::max(mesh_max_bottom_layer_count, mesh.getSettingAsCount("bottom_layers"));
     }
+    const SkinWindowAlgorithm skin_window_algorithm = mesh.getSettingAsSkinWindowAlgorithm("skin_window_algorithm");
+
+    unsigned int processed_layer_count = 0;
+    const bool cache_walls = slice_cache && !is_infill_mesh; // the walls of infill meshes depend on the infill of the other meshes
+    if (!cache_walls && skin_window_algorithm == SkinWindowAlgorithm::PER_LAYER)
+    { // the skin of a layer only needs the walls up to a few layers above it, so the walls and the skin can sweep up the layers together
+        TimeKeeper wavefront_time_keeper;
+        ProgressEstimatorLinear* skin_estimator = new ProgressEstimatorLinear(mesh_layer_count);
+        mesh_inset_skin_progress_estimator->nextStage(skin_estimator); // the walls run just ahead of the skin, so only the progress of the skin is reported
+        processWallsSkinsAndInfillAsWavefront(storage, mesh, process_infill, mesh_max_bottom_layer_count, inset_skin_progress_estimate);
+        log("Walls, skin and infill of mesh %u took %.3f seconds (wavefront)\n", mesh_idx, wavefront_time_keeper.restart());
+        return;
+    }
+
+    if (cache_walls && skin_window_algorithm == SkinWindowAlgorithm::PER_LAYER)
+    {
+        log("Walls, skin and infill of mesh %u are generated one after the other instead of as a wavefront, since the walls go through the slice cache\n", mesh_idx);
+    }
+
+    // walls
+    if (cache_walls && slice_cache->loadWalls(mesh, mesh_idx))
+    {
+        log("Loaded the walls of mesh %u from the slice cache\n", mesh_idx);
+    }
+    else
+    {
+        std::unique_ptr<SettingsReadRecorder> read_recorder(cache_walls ? new SettingsReadRecorder() : nullptr); // the walls only depend on the slices and the settings read here
+#pragma omp parallel for default(none) shared(mesh_layer_count, storage, mesh, inset_skin_progress_estimate, processed_layer_count) schedule(dynamic)
+        for (unsigned int layer_number = 0; layer_number < mesh.layers.size(); layer_number++)
+        {
+            logDebug("Processing insets for layer %i of %i\n", layer_number, mesh_layer_count);
+            processInsets(storage, mesh, layer_number);
+#ifdef _OPENMP
+            if (omp_get_thread_num() == 0)
+#endif
+            { // progress estimation is done only in one thread so that no two threads message progress at the same time
+                int _processed_layer_count;
+#pragma omp atomic read
+                    _processed_layer_count = processed_layer_count;
+                double progress = inset_skin_progress_estimate.progress(_processed_layer_count);
+                Progress::messageProgress(Progress::Stage::INSET_SKIN, progress * 100, 100);
+            }
+#pragma omp atomic
+            processed_layer_count++;
+        }
+        if (read_recorder)
+        {
+            slice_cache->storeWalls(mesh, mesh_idx, read_recorder->getReadSettings());
+        }
+    }
 
+    ProgressEstimatorLinear* skin_estimator = new ProgressEstimatorLinear(mesh_layer_count);
+    mesh_inset_skin_progress_estimator->nextStage(skin_estimator);
+
+    // skin & infill
+//     Progress::messageProgressStage(Progress::Stage::SKIN, &time_keeper);
     processed_layer_count = 0;
-#pragma omp parallel default(none) shared(mesh_layer_count, storage, mesh, mesh_max_bottom_layer_count, process_infill, inset_skin_progress_estimate, processed_layer_count)
+    TimeKeeper skin_time_keeper;
+    SkinWallsCache walls_cache(mesh); // the skin of each layer is computed from the walls of several neighbouring layers
+    SkinNotAirWindows not_air_windows;
+    if (skin_window_algorithm == SkinWindowAlgorithm::SLIDING_WINDOW && mesh.layers.size() > 1 && mesh.getSettingAsSurfaceMode("magic_mesh_surface_mode") != ESurfaceMode::SURFACE)
+    { // computed with the line widths of the second layer, which are used by all layers but the first
+        SkinInfillAreaComputation(1, storage, mesh, process_infill).generateNotAirWindows(not_air_windows);
+    }
+#pragma omp parallel default(none) shared(mesh_layer_count, storage, mesh, mesh_max_bottom_layer_count, process_infill, inset_skin_progress_estimate, processed_layer_count, walls_cache, not_air_windows)
     {
 
 #pragma omp for schedule(dynamic)
@@ -455,8 +557,9 @@ void FffPolygonGenerator::processBasicWallsSkinInfill(SliceDataStorage& storage,
             logDebug("Processing skins and infill layer %i of %i\n", layer_number, mesh_layer_count);
             if (!getSettingBoolean("magic_spiralize") || static_cast<int>(layer_number) < mesh_max_bottom_layer_count)    //Only generate up/downskin and infill for the first X layers when spiralize is choosen.
             {
-                processSkinsAndInfill(storage, mesh, layer_number, process_infill);
+                processSkinsAndInfill(storage, mesh, layer_number, process_infill, walls_cache, not_air_windows);
             }
+            walls_cache.finishLayer(layer_number);
 #ifdef _OPENMP
             if (omp_get_thread_num() == 0)
 #endif
@@ -471,6 +574,46 @@ void FffPolygonGenerator::processBasicWallsSkinInfill(SliceDataStorage& storage,
                 processed_layer_count++;
         }
         }
+    log("Skin and infill of mesh %u took %.3f seconds (%s)\n", mesh_idx, skin_time_keeper.restart(), (not_air_windows.has_above || not_air_windows.has_below) ? "sliding window" : "per layer");
+}
+
+void FffPolygonGenerator::processWallsSkinsAndInfillAsWavefront(SliceDataStorage& storage, SliceMeshStorage& mesh, bool process_infill, int mesh_max_bottom_layer_count, ProgressStageEstimator& inset_skin_progress_estimate)
+{
+    const size_t mesh_layer_count = mesh.layers.size();
+    SkinWallsCache walls_cache(mesh);
+    const SkinNotAirWindows not_air_windows; // only used by the sliding window
+    // the skin looks at the walls up to top_layers or roofing_layer_count layers above, and the top surface to iron at the layer directly above
+    const unsigned int skin_layers_above = std::max(0, std::max(mesh.getSettingAsCount("top_layers"), mesh.getSettingAsCount("roofing_layer_count"))) + 1;
+    unsigned int processed_layer_count = 0;
+
+    WavefrontScheduler wavefront(mesh_layer_count);
+    wavefront.addStage([this, &storage, &mesh, mesh_layer_count](unsigned int layer_number)
+        {
+            logDebug("Processing insets for layer %i of %i\n", layer_number, mesh_layer_count);
+            processInsets(storage, mesh, layer_number);
+        }, 0);
+    wavefront.addStage([&](unsigned int layer_number)
+        {
+            logDebug("Processing skins and infill layer %i of %i\n", layer_number, mesh_layer_count);
+            if (!getSettingBoolean("magic_spiralize") || static_cast<int>(layer_number) < mesh_max_bottom_layer_count)    //Only generate up/downskin and infill for the first X layers when spiralize is choosen.
+            {
+                processSkinsAndInfill(storage, mesh, layer_number, process_infill, walls_cache, not_air_windows);
+            }
+            walls_cache.finishLayer(layer_number);
+#ifdef _OPENMP
+            if (omp_get_thread_num() == 0)
+#endif
+            { // progress estimation is done only in one thread so that no two threads message progress at the same time
+                int _processed_layer_count;
+#pragma omp atomic read
+                    _processed_layer_count = processed_layer_count;
+                double progress = inset_skin_progress_estimate.progress(_processed_layer_count);
+                Progress::messageProgress(Progress::Stage::INSET_SKIN, progress * 100, 100);
+            }
+#pragma omp atomic
+            processed_layer_count++;
+        }, skin_layers_above);
+    wavefront.run();
 }
 
 void FffPolygonGenerator::processOutlineGaps(SliceDataStorage& storage)
@@ -629,6 +772,10 @@ void FffPolygonGenerator::processInfillMesh(SliceDataStorage& storage, unsigned
             }
 
             SliceLayer& other_layer = other_mesh.layers[layer_idx];
+            if (!layer.boundaryBox.hit(other_layer.boundaryBox))
+            { // early out for the whole layer
+                continue;
+            }
 
             for (SliceLayerPart& part : layer.parts)
             {
@@ -668,6 +815,7 @@ void FffPolygonGenerator::processInfillMesh(SliceDataStorage& storage, unsigned
             layer.parts.back().outline = part;
             layer.parts.back().boundaryBox.calculate(part);
         }
+        layer.calculateBoundaryBox();
 
         if (layer.parts.size() > 0 || (mesh.getSettingAsSurfaceMode("magic_mesh_surface_mode") != ESurfaceMode::NORMAL && layer.openPolyLines.size() > 0) )
         {
@@ -746,25 +894,25 @@ void FffPolygonGenerator::processInsets(const SliceDataStorage& storage, SliceMe
     SliceLayer* layer = &mesh.layers[layer_nr];
     if (mesh.getSettingAsSurfaceMode("magic_mesh_surface_mode") != ESurfaceMode::SURFACE)
     {
-        int inset_count = mesh.getSettingAsCount("wall_line_count");
-        if (getSettingBoolean("magic_spiralize") && static_cast<int>(layer_nr) < mesh.getSettingAsCount("bottom_layers") && ((layer_nr % 2) + 2) % 2 == 1)//Add extra insets every 2 layers when spiralizing, this makes bottoms of cups watertight.
+        int inset_count = mesh.getSettingAsCount(wall_line_count_key);
+        if (getSettingBoolean("magic_spiralize") && static_cast<int>(layer_nr) < mesh.getSettingAsCount(bottom_layers_key) && ((layer_nr % 2) + 2) % 2 == 1)//Add extra insets every 2 layers when spiralizing, this makes bottoms of cups watertight.
             inset_count += 5;
-        int line_width_0 = mesh.getSettingInMicrons("wall_line_width_0");
-        int line_width_x = mesh.getSettingInMicrons("wall_line_width_x");
+        int line_width_0 = mesh.getSettingInMicrons(wall_line_width_0_key);
+        int line_width_x = mesh.getSettingInMicrons(wall_line_width_x_key);
         if (layer_nr == 0)
         {
-            const ExtruderTrain& train_wall_0 = *storage.meshgroup->getExtruderTrain(mesh.getSettingAsExtruderNr("wall_0_extruder_nr"));
-            line_width_0 *= train_wall_0.getSettingAsRatio("initial_layer_line_width_factor");
-            const ExtruderTrain& train_wall_x = *storage.meshgroup->getExtruderTrain(mesh.getSettingAsExtruderNr("wall_x_extruder_nr"));
-            line_width_x *= train_wall_x.getSettingAsRatio("initial_layer_line_width_factor");
+            const ExtruderTrain& train_wall_0 = *storage.meshgroup->getExtruderTrain(mesh.getSettingAsExtruderNr(wall_0_extruder_nr_key));
+            line_width_0 *= train_wall_0.getSettingAsRatio(initial_layer_line_width_factor_key);
+            const ExtruderTrain& train_wall_x = *storage.meshgroup->getExtruderTrain(mesh.getSettingAsExtruderNr(wall_x_extruder_nr_key));
+            line_width_x *= train_wall_x.getSettingAsRatio(initial_layer_line_width_factor_key);
         }
-        if (mesh.getSettingBoolean("alternate_extra_perimeter"))
+        if (mesh.getSettingBoolean(alternate_extra_perimeter_key))
         {
             inset_count += ((layer_nr % 2) + 2) % 2;
         }
-        bool recompute_outline_based_on_outer_wall = (mesh.getSettingBoolean("support_enable") || mesh.getSettingBoolean("support_tree_enable")) && !mesh.getSettingBoolean("fill_outline_gaps");
-        bool remove_parts_with_no_insets = !mesh.getSettingBoolean("fill_outline_gaps");
-        WallsComputation walls_computation(mesh.getSettingInMicrons("wall_0_inset"), line_width_0, line_width_x, inset_count, recompute_outline_based_on_outer_wall, remove_parts_with_no_insets);
+        bool recompute_outline_based_on_outer_wall = (mesh.getSettingBoolean(support_enable_key) || mesh.getSettingBoolean(support_tree_enable_key)) && !mesh.getSettingBoolean(fill_outline_gaps_key);
+        bool remove_parts_with_no_insets = !mesh.getSettingBoolean(fill_outline_gaps_key);
+        WallsComputation walls_computation(mesh.getSettingInMicrons(wall_0_inset_key), line_width_0, line_width_x, inset_count, recompute_outline_based_on_outer_wall, remove_parts_with_no_insets);
         walls_computation.generateInsets(layer);
     }
     else
@@ -840,6 +988,7 @@ void FffPolygonGenerator::removeEmptyFirstLayers(SliceDataStorage& storage, cons
         storage.support.layer_nr_max_filled_layer -= n_empty_first_layers;
         std::vector<SupportLayer>& support_layers = storage.support.supportLayers;
         support_layers.erase(support_layers.begin(), support_layers.begin() + n_empty_first_layers);
+        storage.invalidateLayerOutlines(); // the layer numbers have changed
     }
 }
 
@@ -853,17 +1002,17 @@ void FffPolygonGenerator::removeEmptyFirstLayers(SliceDataStorage& storage, cons
  * processSkinsAndInfill read (depend on) mesh.layers[*].parts[*].{insets,boundingBox}.
  *                       write mesh.layers[n].parts[*].{skin_parts,infill_area}.
  */
-void FffPolygonGenerator::processSkinsAndInfill(const SliceDataStorage& storage, SliceMeshStorage& mesh, unsigned int layer_nr, bool process_infill)
+void FffPolygonGenerator::processSkinsAndInfill(const SliceDataStorage& storage, SliceMeshStorage& mesh, unsigned int layer_nr, bool process_infill, SkinWallsCache& walls_cache, const SkinNotAirWindows& not_air_windows)
 {
     if (mesh.getSettingAsSurfaceMode("magic_mesh_surface_mode") == ESurfaceMode::SURFACE)
     {
         return;
     }
 
-    SkinInfillAreaComputation skin_infill_area_computation(layer_nr, storage, mesh, process_infill);
+    SkinInfillAreaComputation skin_infill_area_computation(layer_nr, storage, mesh, process_infill, &walls_cache, &not_air_windows);
     skin_infill_area_computation.generateSkinsAndInfill();
 
-    if (mesh.getSettingBoolean("ironing_enabled") && (!mesh.getSettingBoolean("ironing_only_highest_layer") || (unsigned int)mesh.layer_nr_max_filled_layer == layer_nr))
+    if (mesh.getSettingBoolean(ironing_enabled_key) && (!mesh.getSettingBoolean(ironing_only_highest_layer_key) || (unsigned int)mesh.layer_nr_max_filled_layer == layer_nr))
     {
         // Generate the top surface to iron over.
         mesh.layers[layer_nr].top_surface.setAreasFromMeshAndLayerNumber(mesh, layer_nr);
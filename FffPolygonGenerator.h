@@ -19,6 +19,10 @@
 namespace cura
 {
 
+class SkinWallsCache;
+struct SkinNotAirWindows;
+class SliceCache;
+
 /*!
  * Primary stage in Fused Filament Fabrication processing: Polygons are generated.
  * The model is sliced and each slice consists of polygons representing the outlines: the boundaries between inside and outside the object.
@@ -47,8 +51,20 @@ public:
      * \param storage Output parameter: where the outlines are stored. See SliceLayerPart::outline.
      */
     bool generateAreas(SliceDataStorage& storage, MeshGroup* object, TimeKeeper& timeKeeper);
+
+    /*!
+     * Set the directory in which the slices and walls of each mesh group are cached, see \ref SliceCache.
+     *
+     * \param directory The cache directory, or an empty string to always slice the models and generate the walls.
+     */
+    void setSliceCacheDirectory(const std::string& directory)
+    {
+        slice_cache_directory = directory;
+    }
   
 private:
+    std::string slice_cache_directory; //!< The directory in which the slices and walls are cached, if any
+
     /*!
      * \brief Helper function to get the actual height of the draft shield.
      *
@@ -65,21 +81,36 @@ private:
     /*!
      * Slice the \p object and store the outlines in the \p storage.
      * 
+     * If a slice cache is given, the slices are loaded from the cache if possible and stored in it otherwise.
+     * 
      * \param object The object to slice.
      * \param timeKeeper Object which keeps track of timings of each stage.
      * \param storage Output parameter: where the outlines are stored. See SliceLayerPart::outline.
+     * \param slice_cache The cache of the stages of \p object, if any
      * 
      * \return Whether the process succeeded (always true).
      */
-    bool sliceModel(MeshGroup* object, TimeKeeper& timeKeeper, SliceDataStorage& storage); /// slices the model
+    bool sliceModel(MeshGroup* object, TimeKeeper& timeKeeper, SliceDataStorage& storage, SliceCache* slice_cache); /// slices the model
+
+    /*!
+     * Slice the \p object and store the outlines in the \p storage, without using the slice cache.
+     * 
+     * \param object The object to slice.
+     * \param timeKeeper Object which keeps track of timings of each stage.
+     * \param storage Output parameter: where the outlines are stored. See SliceLayerPart::outline.
+     * 
+     * \return Whether the process succeeded.
+     */
+    bool sliceModelUncached(MeshGroup* object, TimeKeeper& timeKeeper, SliceDataStorage& storage);
 
     /*!
      * Processes the outline information as stored in the \p storage: generates inset perimeter polygons, support area polygons, etc. 
      * 
      * \param storage Input and Output parameter: fetches the outline information (see SliceLayerPart::outline) and generates the other reachable field of the \p storage
      * \param timeKeeper Object which keeps track of timings of each stage.
+     * \param slice_cache The cache of the walls, if any
      */
-    void slices2polygons(SliceDataStorage& storage, TimeKeeper& timeKeeper);
+    void slices2polygons(SliceDataStorage& storage, TimeKeeper& timeKeeper, SliceCache* slice_cache);
     
     /*!
      * Processes the outline information as stored in the \p storage: generates inset perimeter polygons, skin and infill
@@ -88,8 +119,27 @@ private:
      * \param mesh_order_idx The index of the mesh_idx in \p mesh_order to process in the vector of meshes in \p storage
      * \param mesh_order The order in which the meshes are processed (used for infill meshes)
      * \param inset_skin_progress_estimate The progress stage estimate calculator
+     * \param slice_cache The cache of the walls, if any
+     */
+    void processBasicWallsSkinInfill(SliceDataStorage& storage, unsigned int mesh_order_idx, std::vector<unsigned int>& mesh_order, ProgressStageEstimator& inset_skin_progress_estimate, SliceCache* slice_cache);
+
+    /*!
+     * Generate the walls, skin and infill of all layers of a mesh in a single parallel pass over the layers.
+     *
+     * The skin of a layer is generated as soon as the walls of the layers which it looks at are done,
+     * rather than after the walls of all layers are done.
+     * This only overlaps the walls with the skin and infill; the stages after them still start once all layers are done,
+     * so the first layer of gcode isn't written any sooner.
+     * Only applicable when the skin of each layer is computed on its own, i.e. not with the sliding window,
+     * and when the walls aren't stored in the slice cache.
+     *
+     * \param storage The storage of the meshes
+     * \param mesh The mesh of which to generate the walls, skin and infill
+     * \param process_infill Whether to generate the infill areas
+     * \param mesh_max_bottom_layer_count The number of layers which get skin and infill when spiralizing
+     * \param inset_skin_progress_estimate The progress stage estimate calculator
      */
-    void processBasicWallsSkinInfill(SliceDataStorage& storage, unsigned int mesh_order_idx, std::vector<unsigned int>& mesh_order, ProgressStageEstimator& inset_skin_progress_estimate);
+    void processWallsSkinsAndInfillAsWavefront(SliceDataStorage& storage, SliceMeshStorage& mesh, bool process_infill, int mesh_max_bottom_layer_count, ProgressStageEstimator& inset_skin_progress_estimate);
 
     /*!
      * Generate areas for the gaps between outer wall and the outline where the first wall doesn't fit.
@@ -172,8 +222,10 @@ private:
      * \param mesh Input and Output parameter: fetches the outline information (see SliceLayerPart::outline) and generates the other reachable field of the \p storage
      * \param layer_nr The layer for which to generate the skin areas.
      * \param process_infill Generate infill areas
+     * \param walls_cache The cache of the walls of \p mesh shared by the skin computations of all layers
+     * \param not_air_windows The precomputed areas which aren't air above and below each layer of \p mesh, if the sliding window algorithm is used
      */
-    void processSkinsAndInfill(const SliceDataStorage& storage, SliceMeshStorage& mesh, unsigned int layer_nr, bool process_infill);
+    void processSkinsAndInfill(const SliceDataStorage& storage, SliceMeshStorage& mesh, unsigned int layer_nr, bool process_infill, SkinWallsCache& walls_cache, const SkinNotAirWindows& not_air_windows);
 
     /*!
      * Generate the polygons where the draft screen should be.
@@ -120,6 +120,26 @@ public:
         return gcode_writer.setTargetStream(stream);
     }
 
+    /*!
+     * Set the directory in which the slices and walls of each mesh group are cached.
+     * 
+     * \param directory The cache directory, or an empty string to always slice the models and generate the walls.
+     */
+    void setSliceCacheDirectory(const std::string& directory)
+    {
+        polygon_generator.setSliceCacheDirectory(directory);
+    }
+
+    /*!
+     * Also write the planned paths of each layer to a file.
+     * 
+     * \see FffGcodeWriter::setLayerPlanSnapshotFile
+     */
+    bool setLayerPlanSnapshotFile(const char* filename)
+    {
+        return gcode_writer.setLayerPlanSnapshotFile(filename);
+    }
+
     /*!
      * Get the total extruded volume for a specific extruder in mm^3
      * 
@@ -11,6 +11,21 @@
 
 namespace cura {
 
+//! Keys of the settings which are looked up for every travel move and wall line.
+static const SettingKey bridge_wall_coast_key("bridge_wall_coast");
+static const SettingKey bridge_wall_min_length_key("bridge_wall_min_length");
+static const SettingKey initial_layer_line_width_factor_key("initial_layer_line_width_factor");
+static const SettingKey limit_support_retractions_key("limit_support_retractions");
+static const SettingKey meshfix_maximum_travel_resolution_key("meshfix_maximum_travel_resolution");
+static const SettingKey retraction_combing_max_distance_key("retraction_combing_max_distance");
+static const SettingKey retraction_hop_after_extruder_switch_key("retraction_hop_after_extruder_switch");
+static const SettingKey retraction_hop_enabled_key("retraction_hop_enabled");
+static const SettingKey retraction_hop_only_when_collides_key("retraction_hop_only_when_collides");
+static const SettingKey wall_line_count_key("wall_line_count");
+static const SettingKey wall_line_width_0_key("wall_line_width_0");
+static const SettingKey wall_line_width_x_key("wall_line_width_x");
+static const SettingKey wall_min_flow_key("wall_min_flow");
+static const SettingKey wall_min_flow_retract_key("wall_min_flow_retract");
 
 ExtruderPlan::ExtruderPlan(int extruder, int layer_nr, bool is_initial_layer, bool is_raft_layer, int layer_thickness, const FanSpeedLayerTimeSettings& fan_speed_layer_time_settings, const RetractionConfig& retraction_config)
 : extruder(extruder)
@@ -356,11 +371,11 @@ GCodePath& LayerPlan::addTravel(Point p, bool force_comb_retract)
 
     const SettingsBaseVirtual* extr = getLastPlannedExtruderTrainSettings();
 
-    const bool perform_z_hops = extr->getSettingBoolean("retraction_hop_enabled");
-    const coord_t maximum_travel_resolution = extr->getSettingInMicrons("meshfix_maximum_travel_resolution");
+    const bool perform_z_hops = extr->getSettingBoolean(retraction_hop_enabled_key);
+    const coord_t maximum_travel_resolution = extr->getSettingInMicrons(meshfix_maximum_travel_resolution_key);
 
     const bool is_first_travel_of_extruder_after_switch = extruder_plans.back().paths.size() == 1 && (extruder_plans.size() > 1 || last_extruder_previous_layer != getExtruder());
-    bool bypass_combing = is_first_travel_of_extruder_after_switch && extr->getSettingBoolean("retraction_hop_after_extruder_switch");
+    bool bypass_combing = is_first_travel_of_extruder_after_switch && extr->getSettingBoolean(retraction_hop_after_extruder_switch_key);
 
     const bool is_first_travel_of_layer = !static_cast<bool>(last_planned_position);
     if (is_first_travel_of_layer)
@@ -378,7 +393,7 @@ GCodePath& LayerPlan::addTravel(Point p, bool force_comb_retract)
 
     if (comb != nullptr && !bypass_combing)
     {
-        const bool perform_z_hops_only_when_collides = extr->getSettingBoolean("retraction_hop_only_when_collides");
+        const bool perform_z_hops_only_when_collides = extr->getSettingBoolean(retraction_hop_only_when_collides_key);
 
         CombPaths combPaths;
         bool via_outside_makes_combing_fail = perform_z_hops && !perform_z_hops_only_when_collides;
@@ -407,7 +422,7 @@ GCodePath& LayerPlan::addTravel(Point p, bool force_comb_retract)
                 if (combPaths.size() == 1)
                 {
                     CombPath comb_path = combPaths[0];
-                    if (extr->getSettingBoolean("limit_support_retractions") &&
+                    if (extr->getSettingBoolean(limit_support_retractions_key) &&
                         combPaths.throughAir && !comb_path.cross_boundary && comb_path.size() == 2 && comb_path[0] == *last_planned_position && comb_path[1] == p)
                     { // limit the retractions from support to support, which didn't cross anything
                         retract = false;
@@ -434,7 +449,7 @@ GCodePath& LayerPlan::addTravel(Point p, bool force_comb_retract)
                 }
                 last_planned_position = combPath.back();
                 dist += vSize(last_point - p);
-                const double retract_threshold = extr->getSettingInMicrons("retraction_combing_max_distance");
+                const double retract_threshold = extr->getSettingInMicrons(retraction_combing_max_distance_key);
                 path->retract = retract || (retract_threshold > 0 && dist > retract_threshold);
                 // don't perform a z-hop
             }
@@ -447,10 +462,10 @@ GCodePath& LayerPlan::addTravel(Point p, bool force_comb_retract)
         if (was_inside) // when the previous location was from printing something which is considered inside (not support or prime tower etc)
         {               // then move inside the printed part, so that we don't ooze on the outer wall while retraction, but on the inside of the print.
             assert (extr != nullptr);
-            int innermost_wall_line_width = extr->getSettingInMicrons((extr->getSettingAsCount("wall_line_count") > 1) ? "wall_line_width_x" : "wall_line_width_0");
+            int innermost_wall_line_width = extr->getSettingInMicrons((extr->getSettingAsCount(wall_line_count_key) > 1) ? wall_line_width_x_key : wall_line_width_0_key);
             if (layer_nr == 0)
             {
-                innermost_wall_line_width *= extr->getSettingAsRatio("initial_layer_line_width_factor");
+                innermost_wall_line_width *= extr->getSettingAsRatio(initial_layer_line_width_factor_key);
             }
             moveInsideCombBoundary(innermost_wall_line_width);
         }
@@ -587,8 +602,8 @@ void LayerPlan::addWallLine(const Point& p0, const Point& p1, const GCodePathCon
     const bool spiralize = false;
 
     const SettingsBaseVirtual* extr = getLastPlannedExtruderTrainSettings();
-    const double min_bridge_line_len = extr->getSettingInMicrons("bridge_wall_min_length");
-    const double bridge_wall_coast = extr->getSettingInPercentage("bridge_wall_coast");
+    const double min_bridge_line_len = extr->getSettingInMicrons(bridge_wall_min_length_key);
+    const double bridge_wall_coast = extr->getSettingInPercentage(bridge_wall_coast_key);
 
     Point cur_point = p0;
 
@@ -775,9 +790,9 @@ void LayerPlan::addWall(ConstPolygonRef wall, int start_idx, const GCodePathConf
     double distance_to_bridge_start = 0; // will be updated before each line is processed
 
     const SettingsBaseVirtual* extr = getLastPlannedExtruderTrainSettings();
-    const double min_bridge_line_len = extr->getSettingInMicrons("bridge_wall_min_length");
-    const double wall_min_flow = extr->getSettingAsRatio("wall_min_flow");
-    const bool wall_min_flow_retract = extr->getSettingBoolean("wall_min_flow_retract");
+    const double min_bridge_line_len = extr->getSettingInMicrons(bridge_wall_min_length_key);
+    const double wall_min_flow = extr->getSettingAsRatio(wall_min_flow_key);
+    const bool wall_min_flow_retract = extr->getSettingBoolean(wall_min_flow_retract_key);
 
     // helper function to calculate the distance from the start of the current wall line to the first bridge segment
 
@@ -28,6 +28,7 @@ class SliceDataStorage;
 
 class LayerPlan; // forward declaration so that ExtruderPlan can be a friend
 class LayerPlanBuffer; // forward declaration so that ExtruderPlan can be a friend
+class SnapshotWriter; // forward declaration so that ExtruderPlan can be a friend
 
 /*!
  * An extruder plan contains all planned paths (GCodePath) pertaining to a single extruder train.
@@ -38,6 +39,7 @@ class ExtruderPlan
 {
     friend class LayerPlan; // TODO: LayerPlan still does a lot which should actually be handled in this class.
     friend class LayerPlanBuffer; // TODO: LayerPlanBuffer handles paths directly
+    friend class SnapshotWriter; // writes the planned paths
 protected:
     std::vector<GCodePath> paths; //!< The paths planned for this extruder
     std::list<NozzleTempInsert> inserts; //!< The nozzle temperature command inserts, to be inserted in between paths
@@ -230,6 +232,7 @@ class LayerPlanBuffer; // forward declaration to prevent circular dependency
 class LayerPlan : public NoCopy
 {
     friend class LayerPlanBuffer;
+    friend class SnapshotWriter;
 private:
     const SliceDataStorage& storage; //!< The polygon data obtained from FffPolygonProcessor
 
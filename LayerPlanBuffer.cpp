@@ -6,6 +6,7 @@
 #include "utils/logoutput.h"
 #include "FffProcessor.h"
 #include "MergeInfillLines.h"
+#include "SnapshotStream.h"
 
 namespace cura {
 
@@ -22,14 +23,14 @@ void LayerPlanBuffer::push(LayerPlan& layer_plan)
     buffer.push_back(&layer_plan);
 }
 
-void LayerPlanBuffer::handle(LayerPlan& layer_plan, GCodeExport& gcode)
+void LayerPlanBuffer::handle(LayerPlan& layer_plan)
 {
     push(layer_plan);
 
     LayerPlan* to_be_written = processBuffer();
     if (to_be_written)
     {
-        to_be_written->writeGCode(gcode);
+        writeLayerPlan(*to_be_written);
         delete to_be_written;
     }
 }
@@ -62,6 +63,15 @@ LayerPlan* LayerPlanBuffer::processBuffer()
     return nullptr;
 }
 
+void LayerPlanBuffer::writeLayerPlan(LayerPlan& layer_plan)
+{
+    if (snapshot_writer)
+    {
+        snapshot_writer->writeLayerPlan(layer_plan);
+    }
+    layer_plan.writeGCode(gcode);
+}
+
 void LayerPlanBuffer::flush()
 {
     if (buffer.size() > 0)
@@ -70,7 +80,7 @@ void LayerPlanBuffer::flush()
     }
     while (!buffer.empty())
     {
-        buffer.front()->writeGCode(gcode);
+        writeLayerPlan(*buffer.front());
         if (CommandSocket::isInstantiated())
         {
             CommandSocket::getInstance()->flushGcode();
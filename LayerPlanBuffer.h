@@ -16,6 +16,8 @@
 namespace cura 
 {
 
+class SnapshotWriter;
+
 /*!
  * Class for buffering multiple layer plans (\ref LayerPlan) / extruder plans within those layer plans, so that temperature commands can be inserted in earlier layer plans.
  * 
@@ -49,13 +51,26 @@ class LayerPlanBuffer : SettingsMessenger
      * The back is the highest/newest layer.
      */
     std::list<LayerPlan*> buffer;
+
+    SnapshotWriter* snapshot_writer; //!< The writer to which each layer plan is written just before its gcode, if any
 public:
     LayerPlanBuffer(SettingsBaseVirtual* settings, GCodeExport& gcode)
     : SettingsMessenger(settings)
     , gcode(gcode)
     , extruder_used_in_meshgroup(MAX_EXTRUDERS, false)
+    , snapshot_writer(nullptr)
     { }
 
+    /*!
+     * Set the writer to which each layer plan is written just before its gcode is written, e.g. to compare the planned paths between versions of the engine.
+     *
+     * \param writer The writer, or nullptr to stop writing the layer plans
+     */
+    void setSnapshotWriter(SnapshotWriter* writer)
+    {
+        snapshot_writer = writer;
+    }
+
     void setPreheatConfig(MeshGroup& settings);
 
     /*!
@@ -68,9 +83,8 @@ public:
      * Write a layer to gcode if it is popped out of the buffer.
      * 
      * \param layer_plan The layer to handle
-     * \param gcode The exporter with which to write a layer to gcode if the buffer is too large after pushing the new layer.
      */
-    void handle(LayerPlan& layer_plan, GCodeExport& gcode);
+    void handle(LayerPlan& layer_plan);
 
     /*!
      * Write all remaining layer plans (LayerPlan) to gcode and empty the buffer.
@@ -89,6 +103,11 @@ private:
      */
     LayerPlan* processBuffer();
 
+    /*!
+     * Write a layer plan which has left the buffer to gcode, and to the snapshot writer if there is one.
+     */
+    void writeLayerPlan(LayerPlan& layer_plan);
+
     /*!
      * Add the travel move to properly travel from the end location of the previous layer to the starting location of the next
      * 
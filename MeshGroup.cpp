@@ -5,11 +5,18 @@
 #include <string.h>
 #include <strings.h>
 #include <stdio.h>
+#include <stdlib.h> // strtof
 #include <limits>
+#include <utility> // move
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif // _OPENMP
 
 #include "MeshGroup.h"
 #include "utils/gettime.h"
 #include "utils/logoutput.h"
+#include "utils/MappedFile.h"
 #include "utils/string.h"
 
 #include "settings/SettingRegistry.h" // loadExtruderJSONsettings
@@ -19,22 +26,6 @@ namespace cura
 
 FILE* binaryMeshBlob = nullptr;
 
-/* Custom fgets function to support Mac line-ends in Ascii STL files. OpenSCAD produces this when used on Mac */
-void* fgets_(char* ptr, size_t len, FILE* f)
-{
-    while(len && fread(ptr, 1, 1, f) > 0)
-    {
-        if (*ptr == '\n' || *ptr == '\r')
-        {
-            *ptr = '\0';
-            return ptr;
-        }
-        ptr++;
-        len--;
-    }
-    return nullptr;
-}
-
 MeshGroup::MeshGroup(SettingsBaseVirtual* settings_base)
 : SettingsBase(settings_base)
 , extruder_count(-1)
@@ -165,131 +156,277 @@ void MeshGroup::finalize()
     }
 }
 
-bool loadMeshSTL_ascii(Mesh* mesh, const char* filename, const FMatrix3x3& matrix)
+/*!
+ * Parse a floating point number the way sscanf's %f would, but without the overhead of the format string and the locale.
+ *
+ * Plain decimal numbers with an optional fraction and exponent are parsed directly.
+ * Anything else (e.g. "inf" or overly long mantissas) is passed on to strtof.
+ *
+ * \param[in,out] pos The position from which to parse. Leading spaces and tabs are skipped. Set to just after the number on success.
+ * \param end The end of the buffer, which doesn't need to be null terminated.
+ * \param[out] result The parsed number
+ * \return Whether a number could be parsed
+ */
+static inline bool parseFloat(const char*& pos, const char* end, float& result)
 {
-    FILE* f = fopen(filename, "rt");
-    char buffer[1024];
-    FPoint3 vertex;
-    int n = 0;
-    Point3 v0(0,0,0), v1(0,0,0), v2(0,0,0);
-    while(fgets_(buffer, sizeof(buffer), f))
+    const char* p = pos;
+    while (p < end && (*p == ' ' || *p == '\t'))
+    {
+        p++;
+    }
+    const char* number_start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+    uint64_t mantissa = 0;
+    int digit_count = 0;
+    int exponent = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digit_count++)
+    {
+        mantissa = mantissa * 10 + (*p - '0');
+    }
+    if (p < end && *p == '.')
     {
-        if (sscanf(buffer, " vertex %f %f %f", &vertex.x, &vertex.y, &vertex.z) == 3)
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digit_count++)
         {
-            n++;
-            switch(n)
+            mantissa = mantissa * 10 + (*p - '0');
+            exponent--;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E') && digit_count > 0)
+    {
+        const char* exponent_start = p;
+        p++;
+        bool exponent_negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            exponent_negative = *p == '-';
+            p++;
+        }
+        if (p < end && *p >= '0' && *p <= '9')
+        {
+            int explicit_exponent = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; p++)
             {
-            case 1:
-                v0 = matrix.apply(vertex);
-                break;
-            case 2:
-                v1 = matrix.apply(vertex);
-                break;
-            case 3:
-                v2 = matrix.apply(vertex);
-                mesh->addFace(v0, v1, v2);
-                n = 0;
-                break;
+                explicit_exponent = std::min(explicit_exponent * 10 + (*p - '0'), 10000);
             }
+            exponent += exponent_negative ? -explicit_exponent : explicit_exponent;
+        }
+        else
+        { // not an exponent after all, e.g. "1.0e" followed by text
+            p = exponent_start;
         }
     }
-    fclose(f);
-    mesh->finish();
+
+    static const float float_powers_of_ten[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    const bool is_hexadecimal = p < end && (*p == 'x' || *p == 'X');
+    if (digit_count > 0 && digit_count <= 18 && !is_hexadecimal && mantissa <= (1 << 24) && exponent >= -10 && exponent <= 10)
+    { // Both the mantissa and the power of ten are exact in a float, so a single float operation rounds correctly.
+        float value = static_cast<float>(mantissa);
+        value = exponent < 0 ? value / float_powers_of_ten[-exponent] : value * float_powers_of_ten[exponent];
+        result = negative ? -value : value;
+        pos = p;
+        return true;
+    }
+
+    // Slow path: let the standard library deal with it, from a null terminated copy.
+    char buffer[128];
+    size_t length = 0;
+    for (const char* c = number_start; c < end && length + 1 < sizeof(buffer) && *c != '\n' && *c != '\r'; c++)
+    {
+        buffer[length++] = *c;
+    }
+    buffer[length] = '\0';
+    char* parse_end;
+    result = strtof(buffer, &parse_end);
+    if (parse_end == buffer)
+    {
+        return false;
+    }
+    pos = number_start + (parse_end - buffer);
     return true;
 }
 
-bool loadMeshSTL_binary(Mesh* mesh, const char* filename, const FMatrix3x3& matrix)
+/*!
+ * Collect the vertices from the lines of an ASCII STL file of the form "vertex x y z".
+ *
+ * \param begin The start of the part of the file to parse. Should be at the start of a line.
+ * \param end The end of the part of the file to parse
+ * \param matrix The transformation to apply to the vertices
+ * \param[out] vertices The vertices are appended to this list
+ */
+static void parseSTLAsciiVertices(const char* begin, const char* end, const FMatrix3x3& matrix, std::vector<Point3>& vertices)
+{
+    static const char keyword[] = "vertex";
+    constexpr size_t keyword_length = sizeof(keyword) - 1;
+    for (const char* line = begin; line < end; )
+    {
+        const char* line_end = line;
+        while (line_end < end && *line_end != '\n' && *line_end != '\r')
+        {
+            line_end++;
+        }
+
+        const char* pos = line;
+        while (pos < line_end && isspace(static_cast<unsigned char>(*pos)))
+        {
+            pos++;
+        }
+        if (static_cast<size_t>(line_end - pos) > keyword_length && strncmp(pos, keyword, keyword_length) == 0)
+        {
+            pos += keyword_length;
+            FPoint3 vertex;
+            if (parseFloat(pos, line_end, vertex.x) && parseFloat(pos, line_end, vertex.y) && parseFloat(pos, line_end, vertex.z))
+            {
+                vertices.push_back(matrix.apply(vertex));
+            }
+        }
+        line = line_end + 1;
+    }
+}
+
+/*!
+ * Find the start of the first line at or after \p pos which starts a new facet, i.e. of which the first word is "facet".
+ *
+ * \return The start of that line, or \p end if there is no such line
+ */
+static const char* findFacetStart(const char* pos, const char* begin, const char* end)
+{
+    while (pos > begin && *(pos - 1) != '\n' && *(pos - 1) != '\r')
+    { // go to the start of the line
+        pos--;
+    }
+    static const char keyword[] = "facet";
+    constexpr size_t keyword_length = sizeof(keyword) - 1;
+    while (pos < end)
+    {
+        const char* word = pos;
+        while (word < end && (*word == ' ' || *word == '\t'))
+        {
+            word++;
+        }
+        if (static_cast<size_t>(end - word) >= keyword_length && strncmp(word, keyword, keyword_length) == 0)
+        {
+            return pos;
+        }
+        while (pos < end && *pos != '\n' && *pos != '\r')
+        {
+            pos++;
+        }
+        while (pos < end && (*pos == '\n' || *pos == '\r'))
+        {
+            pos++;
+        }
+    }
+    return end;
+}
+
+bool loadMeshSTL_ascii(Mesh* mesh, const MappedFile& file, const FMatrix3x3& matrix)
 {
-    FILE* f = fopen(filename, "rb");
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+
+    // Split the file into chunks at facet boundaries, which are parsed in parallel.
+    int chunk_count = 1;
+#ifdef _OPENMP
+    chunk_count = omp_get_max_threads();
+#endif // _OPENMP
+    chunk_count = std::max(1, std::min(chunk_count, static_cast<int>(file.size() / (1 << 20)))); // at least a megabyte per chunk
+    std::vector<const char*> chunk_starts(chunk_count + 1);
+    chunk_starts[0] = begin;
+    for (int chunk_idx = 1; chunk_idx < chunk_count; chunk_idx++)
+    {
+        chunk_starts[chunk_idx] = findFacetStart(std::max(chunk_starts[chunk_idx - 1], begin + file.size() * chunk_idx / chunk_count), begin, end);
+    }
+    chunk_starts[chunk_count] = end;
 
-    fseek(f, 0L, SEEK_END);
-    long long file_size = ftell(f); //The file size is the position of the cursor after seeking to the end.
-    rewind(f); //Seek back to start.
-    size_t face_count = (file_size - 80 - sizeof(uint32_t)) / 50; //Subtract the size of the header. Every face uses exactly 50 bytes.
+    std::vector<std::vector<Point3>> chunk_vertices(chunk_count);
+#pragma omp parallel for default(none) shared(chunk_starts, chunk_vertices, matrix) firstprivate(chunk_count) schedule(static, 1)
+    for (int chunk_idx = 0; chunk_idx < chunk_count; chunk_idx++)
+    {
+        parseSTLAsciiVertices(chunk_starts[chunk_idx], chunk_starts[chunk_idx + 1], matrix, chunk_vertices[chunk_idx]);
+    }
 
-    char buffer[80];
-    //Skip the header
-    if (fread(buffer, 80, 1, f) != 1)
+    std::vector<Point3> face_vertices = std::move(chunk_vertices[0]);
+    for (int chunk_idx = 1; chunk_idx < chunk_count; chunk_idx++)
     {
-        fclose(f);
-        return false;
+        face_vertices.insert(face_vertices.end(), chunk_vertices[chunk_idx].begin(), chunk_vertices[chunk_idx].end());
+        chunk_vertices[chunk_idx].clear();
+        chunk_vertices[chunk_idx].shrink_to_fit();
     }
 
-    uint32_t reported_face_count;
-    //Read the face count. We'll use it as a sort of redundancy code to check for file corruption.
-    if (fread(&reported_face_count, sizeof(uint32_t), 1, f) != 1)
+    mesh->addFaces(std::move(face_vertices)); // every three consecutive vertices form a face
+    mesh->finish();
+    return true;
+}
+
+bool loadMeshSTL_binary(Mesh* mesh, MappedFile& file, const FMatrix3x3& matrix)
+{
+    //Every Face is 50 Bytes: Normal(3*float), Vertices(9*float), 2 Bytes Spacer
+    constexpr size_t header_size = 80 + sizeof(uint32_t); //80 bytes of header followed by the face count.
+    constexpr size_t face_size = 50;
+    if (file.size() < header_size)
     {
-        fclose(f);
         return false;
     }
-    if (reported_face_count != face_count)
+    const int face_count = (file.size() - header_size) / face_size; //Subtract the size of the header. Every face uses exactly 50 bytes.
+
+    uint32_t reported_face_count;
+    //Read the face count. We'll use it as a sort of redundancy code to check for file corruption.
+    memcpy(&reported_face_count, file.data() + 80, sizeof(uint32_t));
+    if (reported_face_count != static_cast<uint32_t>(face_count))
     {
         logWarning("Face count reported by file (%s) is not equal to actual face count (%s). File could be corrupt!\n", std::to_string(reported_face_count).c_str(), std::to_string(face_count).c_str());
     }
 
-    //For each face read:
-    //float(x,y,z) = normal, float(X,Y,Z)*3 = vertexes, uint16_t = flags
-    // Every Face is 50 Bytes: Normal(3*float), Vertices(9*float), 2 Bytes Spacer
-    mesh->faces.reserve(face_count);
-    mesh->vertices.reserve(face_count);
-    for (unsigned int i = 0; i < face_count; i++)
+    //Decode and transform all faces in parallel. They are independent of each other until their vertices are melded.
+    std::vector<Point3> face_vertices(face_count * 3);
+    const char* faces_data = file.data() + header_size;
+#pragma omp parallel for default(none) shared(face_vertices, matrix) firstprivate(faces_data, face_count) schedule(static)
+    for (int face_idx = 0; face_idx < face_count; face_idx++)
     {
-        if (fread(buffer, 50, 1, f) != 1)
-        {
-            fclose(f);
-            return false;
-        }
-        float *v= ((float*)buffer)+3;
-
-        Point3 v0 = matrix.apply(FPoint3(v[0], v[1], v[2]));
-        Point3 v1 = matrix.apply(FPoint3(v[3], v[4], v[5]));
-        Point3 v2 = matrix.apply(FPoint3(v[6], v[7], v[8]));
-        mesh->addFace(v0, v1, v2);
+        float v[9];
+        memcpy(v, faces_data + face_idx * face_size + 3 * sizeof(float), sizeof(v)); //Skip the normal. Faces are not aligned to 4 bytes.
+        face_vertices[face_idx * 3] = matrix.apply(FPoint3(v[0], v[1], v[2]));
+        face_vertices[face_idx * 3 + 1] = matrix.apply(FPoint3(v[3], v[4], v[5]));
+        face_vertices[face_idx * 3 + 2] = matrix.apply(FPoint3(v[6], v[7], v[8]));
     }
-    fclose(f);
+
+    file.close(); //All faces are decoded, so the mapped pages don't have to stay resident while the vertices are melded.
+    mesh->addFaces(std::move(face_vertices));
     mesh->finish();
     return true;
 }
 
 bool loadMeshSTL(Mesh* mesh, const char* filename, const FMatrix3x3& matrix)
 {
-    FILE* f = fopen(filename, "r");
-    if (f == nullptr)
+    MappedFile file; //The file is mapped only once, even if it turns out not to be ASCII after all.
+    if (!file.open(filename, MappedFile::Access::SEQUENTIAL))
     {
         return false;
     }
 
     //Skip any whitespace at the beginning of the file.
-    unsigned long long num_whitespace = 0; //Number of whitespace characters.
-    unsigned char whitespace;
-    if (fread(&whitespace, 1, 1, f) != 1)
+    const char* start = file.data();
+    const char* end = start + file.size();
+    while (start < end && isspace(static_cast<unsigned char>(*start)))
     {
-        fclose(f);
-        return false;
+        start++;
     }
-    while(isspace(whitespace))
+    if (end - start < 5)
     {
-        num_whitespace++;
-        if (fread(&whitespace, 1, 1, f) != 1)
-        {
-            fclose(f);
-            return false;
-        }
-    }
-    fseek(f, num_whitespace, SEEK_SET); //Seek to the place after all whitespace (we may have just read too far).
-
-    char buffer[6];
-    if (fread(buffer, 5, 1, f) != 1)
-    {
-        fclose(f);
         return false;
     }
-    fclose(f);
 
+    char buffer[6];
+    memcpy(buffer, start, 5);
     buffer[5] = '\0';
     if (stringcasecompare(buffer, "solid") == 0)
     {
-        bool load_success = loadMeshSTL_ascii(mesh, filename, matrix);
+        bool load_success = loadMeshSTL_ascii(mesh, file, matrix);
         if (!load_success)
             return false;
 
@@ -298,11 +435,11 @@ bool loadMeshSTL(Mesh* mesh, const char* filename, const FMatrix3x3& matrix)
         if (mesh->faces.size() < 1)
         {
             mesh->clear();
-            return loadMeshSTL_binary(mesh, filename, matrix);
+            return loadMeshSTL_binary(mesh, file, matrix);
         }
         return true;
     }
-    return loadMeshSTL_binary(mesh, filename, matrix);
+    return loadMeshSTL_binary(mesh, file, matrix);
 }
 
 bool loadMeshIntoMeshGroup(MeshGroup* meshgroup, const char* filename, const FMatrix3x3& transformation, SettingsBaseVirtual* object_parent_settings)
@@ -315,7 +452,7 @@ bool loadMeshIntoMeshGroup(MeshGroup* meshgroup, const char* filename, const FMa
         Mesh mesh = object_parent_settings ? Mesh(object_parent_settings) : Mesh(meshgroup); //If we have object_parent_settings, use them as parent settings. Otherwise, just use meshgroup.
         if(loadMeshSTL(&mesh,filename,transformation)) //Load it! If successful...
         {
-            meshgroup->meshes.push_back(mesh);
+            meshgroup->meshes.push_back(std::move(mesh));
             log("loading '%s' took %.3f seconds\n",filename,load_timer.restart());
             return true;
         }
@@ -0,0 +1,442 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "SliceCache.h"
+
+#include <cinttypes> // PRIx64
+#include <cstdio> // rename, remove, snprintf
+#include <fstream>
+
+#include "MeshGroup.h"
+#include "SnapshotStream.h"
+#include "sliceDataStorage.h"
+#include "utils/MappedFile.h"
+#include "utils/logoutput.h"
+
+namespace cura
+{
+
+static const char slices_file_magic[8] = {'C', 'U', 'R', 'A', 'S', 'L', 'C', '\n'}; //!< The start of each cache file of slices
+static const char walls_file_magic[8] = {'C', 'U', 'R', 'A', 'W', 'L', 'S', '\n'}; //!< The start of each cache file of walls
+static const uint64_t cache_file_version = 4; //!< Increase whenever the format of the cache files changes
+static const uint64_t fnv_offset_basis = 14695981039346656037ull; //!< The initial value of an FNV-1a hash
+
+/*!
+ * Feed a value into an FNV-1a hash, one byte at a time.
+ */
+static void hashValue(uint64_t& hash, const int64_t value)
+{
+    for (unsigned int byte_idx = 0; byte_idx < 8; byte_idx++)
+    {
+        hash ^= (static_cast<uint64_t>(value) >> (byte_idx * 8)) & 0xff;
+        hash *= 1099511628211ull;
+    }
+}
+
+/*!
+ * Feed a sequence of bytes into an FNV-1a hash.
+ */
+static void hashBytes(uint64_t& hash, const char* data, const size_t size)
+{
+    for (size_t byte_idx = 0; byte_idx < size; byte_idx++)
+    {
+        hash ^= static_cast<uint8_t>(data[byte_idx]);
+        hash *= 1099511628211ull;
+    }
+}
+
+/*!
+ * Get the settings objects of which the values of the read settings are stored: the global settings, the mesh group, the extruder trains and the meshes.
+ */
+static std::vector<const SettingsBaseVirtual*> getSettingsScopes(const SettingsBaseVirtual& global_settings, const MeshGroup& meshgroup)
+{
+    std::vector<const SettingsBaseVirtual*> scopes;
+    scopes.push_back(&global_settings);
+    scopes.push_back(&meshgroup);
+    for (unsigned int extruder_nr = 0; extruder_nr < meshgroup.getExtruderCount(); extruder_nr++)
+    {
+        scopes.push_back(meshgroup.getExtruderTrain(extruder_nr));
+    }
+    for (const Mesh& mesh : meshgroup.meshes)
+    {
+        scopes.push_back(&mesh);
+    }
+    return scopes;
+}
+
+/*!
+ * Write the values of the read settings in each settings object.
+ */
+static void writeSettingsFingerprint(SnapshotWriter& writer, const std::vector<const SettingsBaseVirtual*>& scopes, const std::vector<std::string>& read_settings)
+{
+    writer.writeUnsigned(read_settings.size());
+    for (const std::string& setting_name : read_settings)
+    {
+        writer.writeString(setting_name);
+    }
+    writer.writeUnsigned(scopes.size());
+    for (const SettingsBaseVirtual* scope : scopes)
+    {
+        for (const std::string& setting_name : read_settings)
+        {
+            const std::string* value = scope->findSettingString(setting_name);
+            writer.writeUnsigned(value != nullptr);
+            if (value)
+            {
+                writer.writeString(*value);
+            }
+        }
+    }
+}
+
+/*!
+ * Read the values of the settings which a stage read and check whether they still have the same value in each settings object.
+ *
+ * \return Whether the settings haven't changed
+ */
+static bool readSettingsFingerprint(SnapshotReader& reader, const std::vector<const SettingsBaseVirtual*>& scopes)
+{
+    std::vector<std::string> read_settings(reader.readCount());
+    for (std::string& setting_name : read_settings)
+    {
+        setting_name = reader.readString();
+    }
+    if (reader.readCount() != scopes.size())
+    {
+        return false;
+    }
+    for (const SettingsBaseVirtual* scope : scopes)
+    {
+        for (const std::string& setting_name : read_settings)
+        {
+            const std::string* value = scope->findSettingString(setting_name);
+            const bool had_value = reader.readUnsigned();
+            if (reader.hasFailed() || had_value != (value != nullptr) || (had_value && reader.readString() != *value))
+            {
+                return false;
+            }
+        }
+    }
+    return !reader.hasFailed();
+}
+
+/*!
+ * Write a buffer to a file via a temporary file, so that a concurrent run never reads a half written cache file.
+ */
+static bool writeCacheFile(const std::string& file_name, const std::string& buffer)
+{
+    const std::string temporary_file_name = file_name + ".tmp";
+    {
+        std::ofstream out(temporary_file_name, std::ios::binary | std::ios::trunc);
+        out.write(buffer.data(), buffer.size());
+        if (!out.good())
+        {
+            logWarning("Couldn't write the slice cache file %s.\n", temporary_file_name.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary_file_name.c_str(), file_name.c_str()) != 0)
+    {
+        std::remove(file_name.c_str()); // renaming onto an existing file fails on Windows
+        if (std::rename(temporary_file_name.c_str(), file_name.c_str()) != 0)
+        {
+            logWarning("Couldn't write the slice cache file %s.\n", file_name.c_str());
+            std::remove(temporary_file_name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * Check the header of a cache file.
+ *
+ * \return Whether the file is a cache file of the right kind and version
+ */
+static bool readCacheFileHeader(SnapshotReader& reader, const char (&magic)[8])
+{
+    uint64_t version;
+    return reader.readHeader(magic, version) && version == cache_file_version;
+}
+
+SliceCache::SliceCache(const std::string& directory, const SettingsBaseVirtual& global_settings, const MeshGroup& meshgroup)
+: settings_scopes(getSettingsScopes(global_settings, meshgroup))
+, mesh_count(meshgroup.meshes.size())
+, has_slices_digest(false)
+, slices_digest(0)
+, is_walls_file_read(false)
+, are_walls_stored(false)
+{
+    uint64_t hash = fnv_offset_basis;
+    hashValue(hash, meshgroup.meshes.size());
+    for (const Mesh& mesh : meshgroup.meshes)
+    {
+        hashValue(hash, mesh.vertices.size());
+        for (const MeshVertex& vertex : mesh.vertices)
+        {
+            const Point3 location = vertex.p;
+            hashValue(hash, location.x);
+            hashValue(hash, location.y);
+            hashValue(hash, location.z);
+        }
+        hashValue(hash, mesh.faces.size());
+        for (const MeshFace& face : mesh.faces)
+        {
+            hashValue(hash, face.vertex_index[0]);
+            hashValue(hash, face.vertex_index[1]);
+            hashValue(hash, face.vertex_index[2]);
+        }
+    }
+    char hash_string[17];
+    snprintf(hash_string, sizeof(hash_string), "%016" PRIx64, hash);
+    file_name_base = directory + "/" + hash_string;
+}
+
+std::string SliceCache::getSlicesFileName() const
+{
+    return file_name_base + ".slices";
+}
+
+bool SliceCache::loadSlices(SliceDataStorage& storage)
+{
+    MappedFile file;
+    if (!file.open(getSlicesFileName().c_str(), MappedFile::Access::SEQUENTIAL))
+    {
+        return false;
+    }
+    SnapshotReader reader(file.data(), file.size());
+    if (!readCacheFileHeader(reader, slices_file_magic) || !readSettingsFingerprint(reader, settings_scopes))
+    {
+        return false;
+    }
+    const uint64_t digest = reader.readUnsigned();
+    MeshGroup& meshgroup = *storage.meshgroup;
+
+    // read everything before changing the storage, so that a corrupt file doesn't leave the storage half filled
+    const size_t print_layer_count = reader.readCount();
+    std::vector<SupportLayer> support_layers(reader.readCount());
+    for (SupportLayer& support_layer : support_layers)
+    {
+        reader.readPolygons(support_layer.support_bottom);
+        reader.readPolygons(support_layer.support_roof);
+        reader.readPolygons(support_layer.support_mesh_drop_down);
+        reader.readPolygons(support_layer.support_mesh);
+        reader.readPolygons(support_layer.anti_overhang);
+    }
+    if (reader.readCount() != meshgroup.meshes.size())
+    {
+        return false;
+    }
+    std::vector<AABB3D> bounding_box_per_mesh(meshgroup.meshes.size());
+    std::vector<int> layer_nr_max_filled_layer_per_mesh(meshgroup.meshes.size());
+    std::vector<std::vector<SliceLayer>> layers_per_mesh(meshgroup.meshes.size());
+    for (unsigned int mesh_idx = 0; mesh_idx < meshgroup.meshes.size() && !reader.hasFailed(); mesh_idx++)
+    {
+        reader.readAABB3D(bounding_box_per_mesh[mesh_idx]);
+        layer_nr_max_filled_layer_per_mesh[mesh_idx] = reader.readSigned();
+        std::vector<SliceLayer>& layers = layers_per_mesh[mesh_idx];
+        layers.resize(reader.readCount());
+        for (SliceLayer& layer : layers)
+        {
+            layer.printZ = reader.readSigned();
+            layer.thickness = reader.readSigned();
+            reader.readAABB(layer.boundaryBox);
+            reader.readPolygons(layer.openPolyLines);
+            layer.parts.resize(reader.readCount());
+            for (SliceLayerPart& part : layer.parts)
+            {
+                reader.readAABB(part.boundaryBox);
+                reader.readPolygons(part.outline);
+            }
+        }
+    }
+    if (reader.hasFailed() || !reader.isAtEnd())
+    {
+        logWarning("The slice cache file %s is corrupt, so the model is sliced again.\n", getSlicesFileName().c_str());
+        return false;
+    }
+
+    storage.model_min = meshgroup.min();
+    storage.model_max = meshgroup.max();
+    storage.model_size = storage.model_max - storage.model_min;
+    storage.print_layer_count = print_layer_count;
+    storage.support.supportLayers = std::move(support_layers);
+
+    storage.meshes.reserve(meshgroup.meshes.size()); // the meshes may not be moved, just like when slicing
+    for (unsigned int mesh_idx = 0; mesh_idx < meshgroup.meshes.size(); mesh_idx++)
+    {
+        meshgroup.meshes[mesh_idx].setAABB(bounding_box_per_mesh[mesh_idx]); // slicing registers the horizontal expansion and the molds in the bounding boxes, which the later stages use
+        storage.meshes.emplace_back(&storage, &meshgroup.meshes[mesh_idx], 0);
+        SliceMeshStorage& mesh_storage = storage.meshes.back();
+        mesh_storage.layers = std::move(layers_per_mesh[mesh_idx]);
+        mesh_storage.layer_nr_max_filled_layer = layer_nr_max_filled_layer_per_mesh[mesh_idx];
+    }
+    has_slices_digest = true;
+    slices_digest = digest;
+    return true;
+}
+
+bool SliceCache::saveSlices(const SliceDataStorage& storage, const std::vector<std::string>& read_settings)
+{
+    SnapshotWriter writer;
+
+    writer.writeUnsigned(storage.print_layer_count);
+    writer.writeUnsigned(storage.support.supportLayers.size());
+    for (const SupportLayer& support_layer : storage.support.supportLayers)
+    { // the support infill parts are only generated after slicing
+        writer.writePolygons(support_layer.support_bottom);
+        writer.writePolygons(support_layer.support_roof);
+        writer.writePolygons(support_layer.support_mesh_drop_down);
+        writer.writePolygons(support_layer.support_mesh);
+        writer.writePolygons(support_layer.anti_overhang);
+    }
+    writer.writeUnsigned(storage.meshes.size());
+    for (const SliceMeshStorage& mesh_storage : storage.meshes)
+    {
+        writer.writeAABB3D(mesh_storage.bounding_box);
+        writer.writeSigned(mesh_storage.layer_nr_max_filled_layer);
+        writer.writeUnsigned(mesh_storage.layers.size());
+        for (const SliceLayer& layer : mesh_storage.layers)
+        {
+            writer.writeSigned(layer.printZ);
+            writer.writeSigned(layer.thickness);
+            writer.writeAABB(layer.boundaryBox);
+            writer.writePolygons(layer.openPolyLines);
+            writer.writeUnsigned(layer.parts.size());
+            for (const SliceLayerPart& part : layer.parts)
+            {
+                writer.writeAABB(part.boundaryBox);
+                writer.writePolygons(part.outline);
+            }
+        }
+    }
+    uint64_t digest = fnv_offset_basis; // slicing again with different settings may give the same slices, from which the same walls are generated
+    hashBytes(digest, writer.getBuffer().data(), writer.getBuffer().size());
+
+    SnapshotWriter header;
+    header.writeHeader(slices_file_magic, cache_file_version);
+    writeSettingsFingerprint(header, settings_scopes, read_settings);
+    header.writeUnsigned(digest);
+    if (!writeCacheFile(getSlicesFileName(), header.getBuffer() + writer.getBuffer()))
+    {
+        return false;
+    }
+    has_slices_digest = true;
+    slices_digest = digest;
+    return true;
+}
+
+void SliceCache::readWallsFile()
+{
+    if (is_walls_file_read)
+    {
+        return;
+    }
+    is_walls_file_read = true;
+    walls_record_per_mesh.assign(mesh_count, std::string());
+
+    MappedFile file;
+    if (!has_slices_digest || !file.open((file_name_base + ".walls").c_str(), MappedFile::Access::SEQUENTIAL))
+    {
+        return;
+    }
+    SnapshotReader reader(file.data(), file.size());
+    if (!readCacheFileHeader(reader, walls_file_magic) || reader.readUnsigned() != slices_digest || reader.readCount() != mesh_count)
+    { // the walls were generated from other slices
+        return;
+    }
+    for (std::string& walls_record : walls_record_per_mesh)
+    {
+        walls_record = reader.readString();
+    }
+    if (reader.hasFailed() || !reader.isAtEnd())
+    {
+        logWarning("The slice cache file %s.walls is corrupt, so the walls are generated again.\n", file_name_base.c_str());
+        walls_record_per_mesh.assign(mesh_count, std::string());
+    }
+}
+
+bool SliceCache::loadWalls(SliceMeshStorage& mesh, const unsigned int mesh_idx)
+{
+    readWallsFile();
+    const std::string& walls_record = walls_record_per_mesh[mesh_idx];
+    if (walls_record.empty())
+    {
+        return false;
+    }
+    SnapshotReader reader(walls_record.data(), walls_record.size());
+    if (!readSettingsFingerprint(reader, settings_scopes) || reader.readCount() != mesh.layers.size())
+    {
+        return false;
+    }
+    std::vector<std::vector<SliceLayerPart>> parts_per_layer(mesh.layers.size());
+    for (std::vector<SliceLayerPart>& parts : parts_per_layer)
+    {
+        parts.resize(reader.readCount());
+        for (SliceLayerPart& part : parts)
+        {
+            reader.readAABB(part.boundaryBox);
+            reader.readPolygons(part.outline);
+            reader.readPolygons(part.print_outline);
+            part.insets.resize(reader.readCount());
+            for (Polygons& inset : part.insets)
+            {
+                reader.readPolygons(inset);
+            }
+        }
+    }
+    if (reader.hasFailed() || !reader.isAtEnd())
+    {
+        return false;
+    }
+    for (unsigned int layer_nr = 0; layer_nr < mesh.layers.size(); layer_nr++)
+    {
+        mesh.layers[layer_nr].parts = std::move(parts_per_layer[layer_nr]);
+    }
+    return true;
+}
+
+void SliceCache::storeWalls(const SliceMeshStorage& mesh, const unsigned int mesh_idx, const std::vector<std::string>& read_settings)
+{
+    readWallsFile(); // keep the cached walls of the other meshes
+    SnapshotWriter writer;
+    writeSettingsFingerprint(writer, settings_scopes, read_settings);
+    writer.writeUnsigned(mesh.layers.size());
+    for (const SliceLayer& layer : mesh.layers)
+    {
+        writer.writeUnsigned(layer.parts.size());
+        for (const SliceLayerPart& part : layer.parts)
+        { // the walls may have removed parts which are too small, so all of the parts are stored
+            writer.writeAABB(part.boundaryBox);
+            writer.writePolygons(part.outline);
+            writer.writePolygons(part.print_outline);
+            writer.writeUnsigned(part.insets.size());
+            for (const Polygons& inset : part.insets)
+            {
+                writer.writePolygons(inset);
+            }
+        }
+    }
+    walls_record_per_mesh[mesh_idx] = writer.takeBuffer();
+    are_walls_stored = true;
+}
+
+bool SliceCache::saveWalls()
+{
+    if (!are_walls_stored || !has_slices_digest)
+    {
+        return false;
+    }
+    SnapshotWriter writer;
+    writer.writeHeader(walls_file_magic, cache_file_version);
+    writer.writeUnsigned(slices_digest);
+    writer.writeUnsigned(walls_record_per_mesh.size());
+    for (const std::string& walls_record : walls_record_per_mesh)
+    {
+        writer.writeString(walls_record);
+    }
+    are_walls_stored = false;
+    return writeCacheFile(file_name_base + ".walls", writer.getBuffer());
+}
+
+}//namespace cura
@@ -0,0 +1,117 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef SLICE_CACHE_H
+#define SLICE_CACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "utils/NoCopy.h"
+
+namespace cura
+{
+
+class MeshGroup;
+class SettingsBaseVirtual;
+class SliceDataStorage;
+class SliceMeshStorage;
+
+/*!
+ * An on-disk cache of the outcome of the first stages of processing a mesh group, so that a stage is skipped when its input hasn't changed.
+ *
+ * The stages form a chain: the slicing produces the layer parts of each mesh, and the walls of each mesh are generated from its layer parts.
+ * For each stage the names of the settings which were read while it ran are stored, together with their values in the global settings,
+ * the mesh group, each extruder train and each mesh. A stage is only loaded when all of those values are still the same
+ * and when the stages before it were loaded or produced the same result as when it was stored.
+ * A mesh group which is processed again with e.g. only a different infill density, temperature or start code thus skips
+ * the slicing and the walls, while changing the wall line count only generates the walls again.
+ *
+ * The cache files of a mesh group are named after a hash of the vertices and faces of its meshes.
+ * Only the most recent result of each stage is kept. A cache file which can't be read is treated as a miss.
+ *
+ * The cache files are snapshots as written by \ref SnapshotWriter.
+ */
+class SliceCache : NoCopy
+{
+public:
+    /*!
+     * Compute the names of the cache files of a mesh group.
+     *
+     * This needs the vertices and faces of the meshes, so it should be constructed before they are cleared.
+     *
+     * \param directory The directory in which the cache files are stored
+     * \param global_settings The settings which the mesh group inherits from
+     * \param meshgroup The mesh group to process. It should outlive the cache.
+     */
+    SliceCache(const std::string& directory, const SettingsBaseVirtual& global_settings, const MeshGroup& meshgroup);
+
+    /*!
+     * Fill \p storage with the cached slices, as \ref FffPolygonGenerator::sliceModel would have.
+     *
+     * \param storage The storage of the mesh group this cache was constructed with, with no meshes yet
+     * \return Whether the slices were cached with the current values of the settings. Otherwise \p storage is left unchanged.
+     */
+    bool loadSlices(SliceDataStorage& storage);
+
+    /*!
+     * Store the slices in \p storage in the cache.
+     *
+     * \param storage The storage just after slicing
+     * \param read_settings The names of the settings which were read while slicing
+     * \return Whether the cache file could be written
+     */
+    bool saveSlices(const SliceDataStorage& storage, const std::vector<std::string>& read_settings);
+
+    /*!
+     * Replace the layer parts of a mesh by the cached parts with their walls, as \ref FffPolygonGenerator::processInsets would have.
+     *
+     * Only possible when the current slices were loaded from or saved to the cache, because the walls are generated from the slices.
+     *
+     * \param mesh The mesh of which the slices are in the storage
+     * \param mesh_idx The index of \p mesh in the mesh group
+     * \return Whether the walls were cached for the current slices with the current values of the settings. Otherwise \p mesh is left unchanged.
+     */
+    bool loadWalls(SliceMeshStorage& mesh, unsigned int mesh_idx);
+
+    /*!
+     * Store the walls of a mesh, to be written to the cache by \ref saveWalls.
+     *
+     * \param mesh The mesh just after generating its walls
+     * \param mesh_idx The index of \p mesh in the mesh group
+     * \param read_settings The names of the settings which were read while generating the walls
+     */
+    void storeWalls(const SliceMeshStorage& mesh, unsigned int mesh_idx, const std::vector<std::string>& read_settings);
+
+    /*!
+     * Write the walls which were stored to the cache, together with the cached walls of the other meshes.
+     *
+     * \return Whether the cache file was written. Nothing is written if no walls were stored.
+     */
+    bool saveWalls();
+
+    /*!
+     * Get the name of the cache file of the slices of the mesh group.
+     */
+    std::string getSlicesFileName() const;
+
+private:
+    std::vector<const SettingsBaseVirtual*> settings_scopes; //!< The settings objects in which the values of the read settings are stored
+    std::string file_name_base; //!< The path of the cache files of the mesh group, without extension
+    size_t mesh_count; //!< The number of meshes in the mesh group
+    bool has_slices_digest; //!< Whether the current slices were loaded from or saved to the cache
+    uint64_t slices_digest; //!< A hash of the current slices, with which the walls generated from them are stored
+    bool is_walls_file_read; //!< Whether \ref walls_record_per_mesh has been filled from the cache file
+    bool are_walls_stored; //!< Whether the walls of any mesh were stored since the cache file was read
+    std::vector<std::string> walls_record_per_mesh; //!< For each mesh the encoded walls and their settings, or an empty string if they aren't cached
+
+    /*!
+     * Fill \ref walls_record_per_mesh from the cache file, if that hasn't been done yet.
+     */
+    void readWallsFile();
+};
+
+}//namespace cura
+
+#endif//SLICE_CACHE_H
@@ -0,0 +1,619 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "SnapshotStream.h"
+
+#include <cstring> // memcmp, memcpy
+#include <istream>
+#include <limits>
+#include <ostream>
+
+#include "LayerPlan.h"
+#include "sliceDataStorage.h"
+
+namespace cura
+{
+
+static const uint64_t encoding_version = 1; //!< Increase whenever the encoding of any of the structures changes
+static const size_t chunk_size = 1 << 16; //!< The number of bytes which are written to or read from a stream at once
+
+SnapshotWriter::SnapshotWriter()
+: out(nullptr)
+{
+}
+
+SnapshotWriter::SnapshotWriter(std::ostream& out)
+: out(&out)
+{
+    buffer.reserve(chunk_size * 2);
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    flush();
+}
+
+void SnapshotWriter::writeHeader(const char (&magic)[8], const uint64_t version)
+{
+    buffer.append(magic, sizeof(magic));
+    writeUnsigned(encoding_version);
+    writeUnsigned(version);
+}
+
+void SnapshotWriter::writeDouble(const double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (unsigned int byte_idx = 0; byte_idx < 8; byte_idx++)
+    {
+        buffer.push_back(static_cast<char>((bits >> (byte_idx * 8)) & 0xff));
+    }
+}
+
+void SnapshotWriter::writeString(const std::string& value)
+{
+    writeUnsigned(value.size());
+    buffer.append(value);
+    flushChunk();
+}
+
+void SnapshotWriter::writeAABB(const AABB& box)
+{
+    writeSigned(box.min.X);
+    writeSigned(box.min.Y);
+    writeSigned(box.max.X);
+    writeSigned(box.max.Y);
+}
+
+void SnapshotWriter::writeAABB3D(const AABB3D& box)
+{
+    writeSigned(box.min.x);
+    writeSigned(box.min.y);
+    writeSigned(box.min.z);
+    writeSigned(box.max.x);
+    writeSigned(box.max.y);
+    writeSigned(box.max.z);
+}
+
+void SnapshotWriter::writePolygons(const Polygons& polygons)
+{
+    writeUnsigned(polygons.size());
+    for (ConstPolygonRef polygon : polygons)
+    {
+        writeUnsigned(polygon.size());
+        Point previous(0, 0);
+        for (const Point& point : polygon)
+        {
+            writeSigned(point.X - previous.X);
+            writeSigned(point.Y - previous.Y);
+            previous = point;
+        }
+        flushChunk();
+    }
+}
+
+void SnapshotWriter::writeSkinPart(const SkinPart& skin_part)
+{
+    writePolygons(skin_part.outline);
+    writeUnsigned(skin_part.insets.size());
+    for (const Polygons& inset : skin_part.insets)
+    {
+        writePolygons(inset);
+    }
+    writePolygons(skin_part.perimeter_gaps);
+    writePolygons(skin_part.inner_infill);
+    writePolygons(skin_part.roofing_fill);
+}
+
+void SnapshotWriter::writeSliceLayerPart(const SliceLayerPart& part)
+{
+    writeAABB(part.boundaryBox);
+    writePolygons(part.outline);
+    writePolygons(part.print_outline);
+    writeUnsigned(part.insets.size());
+    for (const Polygons& inset : part.insets)
+    {
+        writePolygons(inset);
+    }
+    writePolygons(part.perimeter_gaps);
+    writePolygons(part.outline_gaps);
+    writeUnsigned(part.skin_parts.size());
+    for (const SkinPart& skin_part : part.skin_parts)
+    {
+        writeSkinPart(skin_part);
+    }
+    writePolygons(part.infill_area);
+    writeUnsigned(static_cast<bool>(part.infill_area_own));
+    if (part.infill_area_own)
+    {
+        writePolygons(*part.infill_area_own);
+    }
+    writeUnsigned(part.infill_area_per_combine_per_density.size());
+    for (const std::vector<Polygons>& infill_area_per_combine : part.infill_area_per_combine_per_density)
+    {
+        writeUnsigned(infill_area_per_combine.size());
+        for (const Polygons& infill_area : infill_area_per_combine)
+        {
+            writePolygons(infill_area);
+        }
+    }
+    writeUnsigned(part.spaghetti_infill_volumes.size());
+    for (const std::pair<Polygons, double>& filling_area : part.spaghetti_infill_volumes)
+    {
+        writePolygons(filling_area.first);
+        writeDouble(filling_area.second);
+    }
+}
+
+void SnapshotWriter::writeSliceLayer(const SliceLayer& layer)
+{
+    writeSigned(layer.printZ);
+    writeSigned(layer.thickness);
+    writeAABB(layer.boundaryBox);
+    writePolygons(layer.openPolyLines);
+    writePolygons(layer.top_surface.areas);
+    writeUnsigned(layer.parts.size());
+    for (const SliceLayerPart& part : layer.parts)
+    {
+        writeSliceLayerPart(part);
+    }
+}
+
+void SnapshotWriter::writeSupportInfillPart(const SupportInfillPart& part)
+{
+    writePolygons(part.outline);
+    writeSigned(part.support_line_width);
+    writeSigned(part.inset_count_to_generate);
+    writeAABB(part.outline_boundary_box);
+    writeUnsigned(part.insets.size());
+    for (const Polygons& inset : part.insets)
+    {
+        writePolygons(inset);
+    }
+    writeUnsigned(part.infill_area_per_combine_per_density.size());
+    for (const std::vector<Polygons>& infill_area_per_combine : part.infill_area_per_combine_per_density)
+    {
+        writeUnsigned(infill_area_per_combine.size());
+        for (const Polygons& infill_area : infill_area_per_combine)
+        {
+            writePolygons(infill_area);
+        }
+    }
+    writePolygons(part.infill_area);
+}
+
+void SnapshotWriter::writeSupportLayer(const SupportLayer& support_layer)
+{
+    writeUnsigned(support_layer.support_infill_parts.size());
+    for (const SupportInfillPart& part : support_layer.support_infill_parts)
+    {
+        writeSupportInfillPart(part);
+    }
+    writePolygons(support_layer.support_bottom);
+    writePolygons(support_layer.support_roof);
+    writePolygons(support_layer.support_mesh_drop_down);
+    writePolygons(support_layer.support_mesh);
+    writePolygons(support_layer.anti_overhang);
+}
+
+void SnapshotWriter::writeSupportStorage(const SupportStorage& support)
+{
+    writeUnsigned(support.generated);
+    writeSigned(support.layer_nr_max_filled_layer);
+    writeUnsigned(support.supportLayers.size());
+    for (const SupportLayer& support_layer : support.supportLayers)
+    {
+        writeSupportLayer(support_layer);
+    }
+}
+
+void SnapshotWriter::writeLayerPlan(const LayerPlan& layer_plan)
+{
+    writeSigned(layer_plan.layer_nr);
+    writeSigned(layer_plan.z);
+    writeSigned(layer_plan.layer_thickness);
+    size_t path_count = 0;
+    for (const ExtruderPlan& extruder_plan : layer_plan.extruder_plans)
+    {
+        path_count += extruder_plan.paths.size();
+    }
+    writeUnsigned(path_count);
+    for (const ExtruderPlan& extruder_plan : layer_plan.extruder_plans)
+    {
+        for (const GCodePath& path : extruder_plan.paths)
+        {
+            const GCodePathConfig& config = *path.config;
+            writeSigned(extruder_plan.extruder);
+            writeUnsigned(static_cast<uint64_t>(config.getPrintFeatureType()));
+            writeSigned(config.getLineWidth());
+            writeSigned(config.getLayerThickness());
+            writeDouble(config.getFlowPercentage());
+            writeDouble(config.getSpeed());
+            writeDouble(config.getAcceleration());
+            writeDouble(config.getJerk());
+            writeUnsigned(config.isBridgePath());
+            writeDouble(config.getFanSpeed());
+            writeUnsigned(static_cast<uint64_t>(path.space_fill_type));
+            writeDouble(path.flow);
+            writeDouble(path.speed_factor);
+            writeUnsigned(path.retract);
+            writeUnsigned(path.perform_z_hop);
+            writeUnsigned(path.perform_prime);
+            writeUnsigned(path.spiralize);
+            writeDouble(path.fan_speed);
+            writeUnsigned(path.points.size());
+            Point previous(0, 0);
+            for (const Point& point : path.points)
+            {
+                writeSigned(point.X - previous.X);
+                writeSigned(point.Y - previous.Y);
+                previous = point;
+            }
+            flushChunk();
+        }
+    }
+}
+
+std::string SnapshotWriter::takeBuffer()
+{
+    std::string taken;
+    taken.swap(buffer);
+    return taken;
+}
+
+bool SnapshotWriter::flush()
+{
+    if (!out)
+    {
+        return true;
+    }
+    out->write(buffer.data(), buffer.size());
+    buffer.clear();
+    out->flush();
+    return out->good();
+}
+
+void SnapshotWriter::flushChunk()
+{
+    if (out && buffer.size() >= chunk_size)
+    {
+        out->write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
+
+SnapshotReader::SnapshotReader(const char* data, const size_t size)
+: failed(false)
+, in(nullptr)
+, position(data)
+, end(data + size)
+, stream_remaining(0)
+{
+}
+
+SnapshotReader::SnapshotReader(std::istream& in)
+: failed(false)
+, in(&in)
+, chunk(chunk_size)
+, position(chunk.data())
+, end(chunk.data())
+, stream_remaining(std::numeric_limits<uint64_t>::max())
+{
+    const std::istream::pos_type start = in.tellg();
+    if (start != std::istream::pos_type(-1) && in.seekg(0, std::ios::end))
+    {
+        const std::istream::pos_type stream_end = in.tellg();
+        if (stream_end != std::istream::pos_type(-1) && stream_end >= start)
+        {
+            stream_remaining = static_cast<uint64_t>(stream_end - start);
+        }
+        in.seekg(start);
+    }
+    in.clear(); // a stream which can't seek is read until it ends
+}
+
+bool SnapshotReader::readHeader(const char (&magic)[8], uint64_t& version)
+{
+    char read_magic[sizeof(magic)];
+    for (char& byte : read_magic)
+    {
+        if (position == end && !refill())
+        {
+            fail();
+            return false;
+        }
+        byte = *position++;
+    }
+    if (memcmp(read_magic, magic, sizeof(magic)) != 0 || readUnsigned() != encoding_version)
+    {
+        fail();
+        return false;
+    }
+    version = readUnsigned();
+    return !failed;
+}
+
+bool SnapshotReader::isAtEnd()
+{
+    return position == end && !refill();
+}
+
+size_t SnapshotReader::readCount()
+{
+    const uint64_t count = readUnsigned();
+    if (count > getRemaining())
+    {
+        fail();
+        return 0;
+    }
+    return count;
+}
+
+double SnapshotReader::readDouble()
+{
+    uint64_t bits = 0;
+    for (unsigned int byte_idx = 0; byte_idx < 8; byte_idx++)
+    {
+        if (position == end && !refill())
+        {
+            fail();
+            return 0;
+        }
+        bits |= static_cast<uint64_t>(static_cast<uint8_t>(*position++)) << (byte_idx * 8);
+    }
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::string SnapshotReader::readString()
+{
+    size_t length = readCount();
+    std::string value;
+    value.reserve(length);
+    while (length > 0)
+    {
+        if (position == end && !refill())
+        {
+            fail();
+            return std::string();
+        }
+        const size_t available = std::min(length, static_cast<size_t>(end - position));
+        value.append(position, available);
+        position += available;
+        length -= available;
+    }
+    return value;
+}
+
+void SnapshotReader::readAABB(AABB& box)
+{
+    box.min.X = readSigned();
+    box.min.Y = readSigned();
+    box.max.X = readSigned();
+    box.max.Y = readSigned();
+}
+
+void SnapshotReader::readAABB3D(AABB3D& box)
+{
+    box.min.x = readSigned();
+    box.min.y = readSigned();
+    box.min.z = readSigned();
+    box.max.x = readSigned();
+    box.max.y = readSigned();
+    box.max.z = readSigned();
+}
+
+void SnapshotReader::readPolygons(Polygons& polygons)
+{
+    const size_t polygon_count = readCount();
+    for (size_t polygon_idx = 0; polygon_idx < polygon_count && !failed; polygon_idx++)
+    {
+        const size_t point_count = readCount();
+        PolygonRef polygon = polygons.newPoly();
+        polygon.reserve(point_count);
+        Point point(0, 0);
+        for (size_t point_idx = 0; point_idx < point_count; point_idx++)
+        {
+            point.X += readSigned();
+            point.Y += readSigned();
+            polygon.add(point);
+        }
+    }
+}
+
+void SnapshotReader::readSkinPart(SkinPart& skin_part)
+{
+    readPolygons(skin_part.outline);
+    skin_part.insets.resize(readCount());
+    for (Polygons& inset : skin_part.insets)
+    {
+        readPolygons(inset);
+    }
+    readPolygons(skin_part.perimeter_gaps);
+    readPolygons(skin_part.inner_infill);
+    readPolygons(skin_part.roofing_fill);
+}
+
+void SnapshotReader::readSliceLayerPart(SliceLayerPart& part)
+{
+    readAABB(part.boundaryBox);
+    readPolygons(part.outline);
+    readPolygons(part.print_outline);
+    part.insets.resize(readCount());
+    for (Polygons& inset : part.insets)
+    {
+        readPolygons(inset);
+    }
+    readPolygons(part.perimeter_gaps);
+    readPolygons(part.outline_gaps);
+    part.skin_parts.resize(readCount());
+    for (SkinPart& skin_part : part.skin_parts)
+    {
+        readSkinPart(skin_part);
+    }
+    readPolygons(part.infill_area);
+    if (readUnsigned())
+    {
+        part.infill_area_own.emplace();
+        readPolygons(*part.infill_area_own);
+    }
+    part.infill_area_per_combine_per_density.resize(readCount());
+    for (std::vector<Polygons>& infill_area_per_combine : part.infill_area_per_combine_per_density)
+    {
+        infill_area_per_combine.resize(readCount());
+        for (Polygons& infill_area : infill_area_per_combine)
+        {
+            readPolygons(infill_area);
+        }
+    }
+    part.spaghetti_infill_volumes.resize(readCount());
+    for (std::pair<Polygons, double>& filling_area : part.spaghetti_infill_volumes)
+    {
+        readPolygons(filling_area.first);
+        filling_area.second = readDouble();
+    }
+}
+
+void SnapshotReader::readSliceLayer(SliceLayer& layer)
+{
+    layer.printZ = readSigned();
+    layer.thickness = readSigned();
+    readAABB(layer.boundaryBox);
+    readPolygons(layer.openPolyLines);
+    readPolygons(layer.top_surface.areas);
+    layer.parts.resize(readCount());
+    for (SliceLayerPart& part : layer.parts)
+    {
+        readSliceLayerPart(part);
+    }
+}
+
+void SnapshotReader::readSupportInfillPart(std::vector<SupportInfillPart>& parts)
+{
+    PolygonsPart outline;
+    readPolygons(outline);
+    const coord_t support_line_width = readSigned();
+    const int inset_count_to_generate = readSigned();
+    parts.emplace_back(outline, support_line_width, inset_count_to_generate);
+    SupportInfillPart& part = parts.back();
+    readAABB(part.outline_boundary_box);
+    part.insets.resize(readCount());
+    for (Polygons& inset : part.insets)
+    {
+        readPolygons(inset);
+    }
+    part.infill_area_per_combine_per_density.resize(readCount());
+    for (std::vector<Polygons>& infill_area_per_combine : part.infill_area_per_combine_per_density)
+    {
+        infill_area_per_combine.resize(readCount());
+        for (Polygons& infill_area : infill_area_per_combine)
+        {
+            readPolygons(infill_area);
+        }
+    }
+    readPolygons(part.infill_area);
+}
+
+void SnapshotReader::readSupportLayer(SupportLayer& support_layer)
+{
+    const size_t part_count = readCount();
+    support_layer.support_infill_parts.reserve(part_count);
+    for (size_t part_idx = 0; part_idx < part_count && !failed; part_idx++)
+    {
+        readSupportInfillPart(support_layer.support_infill_parts);
+    }
+    readPolygons(support_layer.support_bottom);
+    readPolygons(support_layer.support_roof);
+    readPolygons(support_layer.support_mesh_drop_down);
+    readPolygons(support_layer.support_mesh);
+    readPolygons(support_layer.anti_overhang);
+}
+
+void SnapshotReader::readSupportStorage(SupportStorage& support)
+{
+    support.generated = readUnsigned();
+    support.layer_nr_max_filled_layer = readSigned();
+    support.supportLayers.resize(readCount());
+    for (SupportLayer& support_layer : support.supportLayers)
+    {
+        readSupportLayer(support_layer);
+    }
+}
+
+void SnapshotReader::readLayerPlan(LayerPlanSnapshot& layer_plan)
+{
+    layer_plan.layer_nr = readSigned();
+    layer_plan.z = readSigned();
+    layer_plan.layer_thickness = readSigned();
+    layer_plan.paths.resize(readCount());
+    for (PathSnapshot& path : layer_plan.paths)
+    {
+        path.extruder = readSigned();
+        path.type = static_cast<PrintFeatureType>(readUnsigned());
+        path.line_width = readSigned();
+        path.layer_thickness = readSigned();
+        path.config_flow = readDouble();
+        path.speed_derivatives.speed = readDouble();
+        path.speed_derivatives.acceleration = readDouble();
+        path.speed_derivatives.jerk = readDouble();
+        path.is_bridge_path = readUnsigned();
+        path.config_fan_speed = readDouble();
+        path.space_fill_type = static_cast<SpaceFillType>(readUnsigned());
+        path.flow = readDouble();
+        path.speed_factor = readDouble();
+        path.retract = readUnsigned();
+        path.perform_z_hop = readUnsigned();
+        path.perform_prime = readUnsigned();
+        path.spiralize = readUnsigned();
+        path.fan_speed = readDouble();
+        path.points.resize(readCount());
+        Point point(0, 0);
+        for (Point& path_point : path.points)
+        {
+            point.X += readSigned();
+            point.Y += readSigned();
+            path_point = point;
+        }
+    }
+}
+
+bool SnapshotReader::refill()
+{
+    if (!in || failed || stream_remaining == 0)
+    {
+        return false;
+    }
+    in->read(chunk.data(), chunk.size());
+    const size_t read_size = in->gcount();
+    if (read_size == 0)
+    {
+        stream_remaining = 0;
+        return false;
+    }
+    position = chunk.data();
+    end = position + read_size;
+    if (stream_remaining != std::numeric_limits<uint64_t>::max())
+    {
+        stream_remaining -= std::min(stream_remaining, static_cast<uint64_t>(read_size));
+    }
+    return true;
+}
+
+uint64_t SnapshotReader::getRemaining() const
+{
+    if (stream_remaining == std::numeric_limits<uint64_t>::max())
+    { // the size of the stream is unknown
+        return stream_remaining;
+    }
+    return stream_remaining + (end - position);
+}
+
+void SnapshotReader::fail()
+{
+    failed = true;
+    position = end;
+    stream_remaining = 0;
+}
+
+}//namespace cura
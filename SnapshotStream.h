@@ -0,0 +1,314 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef SNAPSHOT_STREAM_H
+#define SNAPSHOT_STREAM_H
+
+#include <iosfwd>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "GCodePathConfig.h"
+#include "PrintFeature.h"
+#include "SpaceFillType.h"
+#include "utils/IntPoint.h"
+#include "utils/NoCopy.h"
+
+namespace cura
+{
+
+class AABB;
+struct AABB3D;
+class LayerPlan;
+class Polygons;
+class SkinPart;
+class SliceLayer;
+class SliceLayerPart;
+class SupportInfillPart;
+class SupportLayer;
+class SupportStorage;
+
+static constexpr char layer_plans_snapshot_magic[8] = {'C', 'U', 'R', 'A', 'L', 'P', 'S', '\n'}; //!< The start of a snapshot of all layer plans, see \ref LayerPlanSnapshot
+static constexpr uint64_t layer_plans_snapshot_version = 1; //!< The version of the layout of a snapshot of all layer plans
+
+/*!
+ * The planned paths of an extruder plan of a layer plan, with the settings of their configs.
+ *
+ * A \ref GCodePath only points to its config, so this holds enough to rebuild both of them.
+ */
+struct PathSnapshot
+{
+    int extruder; //!< The extruder of the extruder plan the path is part of
+    PrintFeatureType type; //!< \see GCodePathConfig::type
+    int line_width; //!< \see GCodePathConfig::getLineWidth
+    int layer_thickness; //!< \see GCodePathConfig::getLayerThickness
+    double config_flow; //!< \see GCodePathConfig::getFlowPercentage
+    GCodePathConfig::SpeedDerivatives speed_derivatives; //!< \see GCodePathConfig::getSpeed
+    bool is_bridge_path; //!< \see GCodePathConfig::isBridgePath
+    double config_fan_speed; //!< \see GCodePathConfig::getFanSpeed
+    SpaceFillType space_fill_type; //!< \see GCodePath::space_fill_type
+    double flow; //!< \see GCodePath::flow
+    double speed_factor; //!< \see GCodePath::speed_factor
+    bool retract; //!< \see GCodePath::retract
+    bool perform_z_hop; //!< \see GCodePath::perform_z_hop
+    bool perform_prime; //!< \see GCodePath::perform_prime
+    bool spiralize; //!< \see GCodePath::spiralize
+    double fan_speed; //!< \see GCodePath::fan_speed
+    std::vector<Point> points; //!< \see GCodePath::points
+};
+
+/*!
+ * The planned paths of a layer plan, in the order in which they are printed.
+ *
+ * A snapshot of all layer plans (see \ref FffGcodeWriter::setLayerPlanSnapshotFile) starts with \ref layer_plans_snapshot_magic,
+ * followed by the layer plans in the order in which they were written to gcode, until the end of the snapshot.
+ */
+struct LayerPlanSnapshot
+{
+    int layer_nr; //!< \see LayerPlan::getLayerNr
+    int z; //!< The height of the layer
+    int layer_thickness; //!< The thickness of the layer
+    std::vector<PathSnapshot> paths; //!< The paths of all extruder plans
+};
+
+/*!
+ * Writes a snapshot of intermediate geometry, with which the outcome of a stage can be stored and read back,
+ * e.g. to cache it or to compare it with the outcome of another version of the engine.
+ *
+ * A snapshot starts with a magic of 8 bytes which tells what kind of snapshot it is, the version of the encoding below and
+ * the version of the layout of the data which follows, as chosen by the writer of the snapshot.
+ *
+ * All values are variable-length integers of 7 bits per byte, where signed values are zigzag encoded so that small negative numbers are short too.
+ * Floating point values are stored as the 8 bytes of their IEEE representation.
+ * A sequence is stored as its number of elements followed by the elements.
+ * The vertices of each polygon or path are stored relative to the previous vertex, so that most coordinates take one or two bytes.
+ *
+ * The snapshot is either written into a buffer in memory or streamed to an output stream.
+ * When streaming, the data is written to the stream in chunks, so a snapshot of any size only takes a chunk of memory.
+ */
+class SnapshotWriter : NoCopy
+{
+public:
+    /*!
+     * Write into a buffer, which is retrieved with \ref getBuffer or \ref takeBuffer
+     */
+    SnapshotWriter();
+
+    /*!
+     * Write to a stream, which should be opened in binary mode.
+     *
+     * \param out The stream to write to. It should outlive the writer.
+     */
+    SnapshotWriter(std::ostream& out);
+
+    /*!
+     * Writes what is left in the buffer to the stream, if any.
+     */
+    ~SnapshotWriter();
+
+    /*!
+     * Write the magic and versions with which a snapshot starts.
+     *
+     * \param magic What kind of snapshot this is
+     * \param version The version of the layout of the data which follows. Increase it whenever that layout changes.
+     */
+    void writeHeader(const char (&magic)[8], uint64_t version);
+
+    void writeUnsigned(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            buffer.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<char>(value));
+    }
+
+    void writeSigned(const int64_t value)
+    {
+        writeUnsigned((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void writeDouble(double value);
+    void writeString(const std::string& value);
+    void writeAABB(const AABB& box);
+    void writeAABB3D(const AABB3D& box);
+    void writePolygons(const Polygons& polygons);
+    void writeSkinPart(const SkinPart& skin_part);
+    void writeSliceLayerPart(const SliceLayerPart& part);
+    void writeSliceLayer(const SliceLayer& layer);
+    void writeSupportInfillPart(const SupportInfillPart& part);
+    void writeSupportLayer(const SupportLayer& support_layer);
+
+    /*!
+     * Write the support areas of each layer.
+     *
+     * The cross fill provider is not part of the snapshot; it is derived from the settings.
+     */
+    void writeSupportStorage(const SupportStorage& support);
+
+    /*!
+     * Write the planned paths of a layer plan, to be read back by \ref SnapshotReader::readLayerPlan
+     */
+    void writeLayerPlan(const LayerPlan& layer_plan);
+
+    /*!
+     * Get what has been written into the buffer; when streaming only what hasn't been flushed yet.
+     */
+    const std::string& getBuffer() const
+    {
+        return buffer;
+    }
+
+    /*!
+     * Get what has been written into the buffer and empty the buffer.
+     */
+    std::string takeBuffer();
+
+    /*!
+     * Write the buffer to the stream, if streaming.
+     *
+     * \return Whether everything written so far was written to the stream successfully
+     */
+    bool flush();
+
+private:
+    std::ostream* out; //!< The stream to write to, or nullptr when writing into the buffer
+    std::string buffer; //!< The data which hasn't been written to the stream yet
+
+    /*!
+     * Write the buffer to the stream if it has grown to a chunk.
+     */
+    void flushChunk();
+};
+
+/*!
+ * Reads a snapshot, either from memory (e.g. a \ref MappedFile) or streaming from an input stream.
+ *
+ * Reading past the end or reading a malformed value marks the reader as failed, after which zeros and empty values are read.
+ * Counts which can't be right are rejected before anything is allocated for them, so a corrupt snapshot can't exhaust the memory.
+ */
+class SnapshotReader : NoCopy
+{
+public:
+    /*!
+     * Read from memory.
+     *
+     * \param data The start of the snapshot. It should outlive the reader.
+     * \param size The number of bytes of the snapshot
+     */
+    SnapshotReader(const char* data, size_t size);
+
+    /*!
+     * Read from a stream, which should be opened in binary mode.
+     *
+     * \param in The stream to read from. It should outlive the reader.
+     */
+    SnapshotReader(std::istream& in);
+
+    /*!
+     * Read and check the magic and versions with which a snapshot starts.
+     *
+     * \param magic What kind of snapshot is expected
+     * \param[out] version The version of the layout of the data which follows
+     * \return Whether the snapshot is of the expected kind and was encoded the way this reader decodes it
+     */
+    bool readHeader(const char (&magic)[8], uint64_t& version);
+
+    /*!
+     * Whether the data didn't hold what was read
+     */
+    bool hasFailed() const
+    {
+        return failed;
+    }
+
+    /*!
+     * Whether all of the data has been read
+     */
+    bool isAtEnd();
+
+    uint64_t readUnsigned()
+    {
+        uint64_t value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7)
+        {
+            if (position == end && !refill())
+            {
+                break;
+            }
+            const uint8_t byte = static_cast<uint8_t>(*position++);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+                return value;
+            }
+        }
+        fail();
+        return 0;
+    }
+
+    int64_t readSigned()
+    {
+        const uint64_t value = readUnsigned();
+        return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    /*!
+     * Read the number of elements which follow.
+     *
+     * Each element takes at least one byte, so a count larger than the rest of the data is rejected.
+     */
+    size_t readCount();
+
+    double readDouble();
+    std::string readString();
+    void readAABB(AABB& box);
+    void readAABB3D(AABB3D& box);
+
+    /*!
+     * Read polygons and add them to \p polygons
+     */
+    void readPolygons(Polygons& polygons);
+    void readSkinPart(SkinPart& skin_part);
+    void readSliceLayerPart(SliceLayerPart& part);
+    void readSliceLayer(SliceLayer& layer);
+
+    /*!
+     * Read a support infill part and add it to \p parts, since it can't be constructed empty.
+     */
+    void readSupportInfillPart(std::vector<SupportInfillPart>& parts);
+    void readSupportLayer(SupportLayer& support_layer);
+    void readSupportStorage(SupportStorage& support);
+    void readLayerPlan(LayerPlanSnapshot& layer_plan);
+
+private:
+    bool failed; //!< Whether the data didn't hold what was read
+    std::istream* in; //!< The stream to read from, or nullptr when reading from memory
+    std::vector<char> chunk; //!< The part of the stream which is being read
+    const char* position; //!< The next byte to read
+    const char* end; //!< Past the last byte which can be read without refilling
+    uint64_t stream_remaining; //!< The number of bytes left in the stream after the chunk, or the maximum if the stream can't tell
+
+    /*!
+     * Read the next chunk of the stream.
+     *
+     * \return Whether any bytes were read
+     */
+    bool refill();
+
+    /*!
+     * Get (an upper bound of) the number of bytes which haven't been read yet.
+     */
+    uint64_t getRemaining() const;
+
+    /*!
+     * Mark the reader as failed and skip the rest of the data.
+     */
+    void fail();
+};
+
+}//namespace cura
+
+#endif//SNAPSHOT_STREAM_H
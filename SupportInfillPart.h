@@ -23,6 +23,8 @@ namespace cura
  */
 class SupportInfillPart
 {
+    friend class SnapshotReader; // restores the infill area
+    friend class SnapshotWriter;
 public:
     PolygonsPart outline;  //!< The outline of the support infill area
     std::vector<Polygons> insets;  //!< The insets are also known as perimeters or the walls.
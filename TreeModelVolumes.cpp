@@ -0,0 +1,176 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For std::min and std::count.
+#include <cmath> //For sin, tan and round.
+#include <limits> //For the maximum move distance of vertical branches.
+#include <utility> //For std::move.
+
+#include "sliceDataStorage.h"
+#include "TreeModelVolumes.h"
+#include "utils/logoutput.h"
+
+namespace cura
+{
+
+TreeModelVolumes::TreeModelVolumes(const SliceDataStorage& storage, const Polygons& machine_volume_border)
+: xy_distance(storage.getSettingInMicrons("support_xy_distance"))
+, radius_sample_resolution(storage.getSettingInMicrons("support_tree_collision_resolution"))
+, collision_per_layer(storage.support.supportLayers.size())
+{
+    const coord_t branch_radius = storage.getSettingInMicrons("support_tree_branch_diameter") / 2;
+    const coord_t layer_height = storage.getSettingInMicrons("layer_height");
+    const double diameter_angle_scale_factor = sin(storage.getSettingInAngleRadians("support_tree_branch_diameter_angle")) * layer_height / branch_radius; //Scale factor per layer to produce the desired angle.
+    const coord_t maximum_radius = branch_radius + storage.support.supportLayers.size() * branch_radius * diameter_angle_scale_factor;
+    radius_sample_count = (size_t)std::round((float)maximum_radius / radius_sample_resolution) + 1;
+    const double angle = storage.getSettingInAngleRadians("support_tree_angle");
+    maximum_move_distance = angle < 90 ? (coord_t)(tan(angle) * layer_height) : std::numeric_limits<coord_t>::max();
+    avoidance_per_radius_sample = std::vector<RadiusAvoidance>(radius_sample_count);
+
+    constexpr bool include_helper_parts = false;
+#pragma omp parallel for shared(storage, machine_volume_border) schedule(dynamic)
+    for (size_t layer_nr = 0; layer_nr < collision_per_layer.size(); layer_nr++)
+    {
+        LayerCollision& layer_collision = collision_per_layer[layer_nr];
+        layer_collision.outlines = storage.getLayerOutlines(layer_nr, include_helper_parts).unionPolygons(machine_volume_border);
+        layer_collision.per_radius_sample.reserve(radius_sample_count); //So that the references to the collision areas stay valid while larger samples are added.
+        layer_collision.per_radius_sample.push_back(layer_collision.outlines.offset(xy_distance, ClipperLib::JoinType::jtRound)); //Radius 0: only the X/Y distance.
+        layer_collision.has_radius_sample.push_back(true);
+    }
+}
+
+const Polygons& TreeModelVolumes::getCollision(size_t radius_sample, const size_t layer_nr)
+{
+    radius_sample = std::min(radius_sample, radius_sample_count - 1);
+    LayerCollision& layer_collision = collision_per_layer[layer_nr];
+    layer_collision.lock.lock();
+    std::vector<Polygons>& per_radius_sample = layer_collision.per_radius_sample;
+    if (per_radius_sample.size() <= radius_sample)
+    {
+        per_radius_sample.resize(radius_sample + 1);
+        layer_collision.has_radius_sample.resize(radius_sample + 1, false);
+    }
+    if (!layer_collision.has_radius_sample[radius_sample])
+    {
+        const coord_t radius = radius_sample * radius_sample_resolution;
+        per_radius_sample[radius_sample] = layer_collision.outlines.offset(xy_distance + radius, ClipperLib::JoinType::jtRound); //Enough space to avoid the (sampled) width of the branch.
+        layer_collision.has_radius_sample[radius_sample] = true;
+    }
+    else
+    {
+        layer_collision.hit_count++;
+    }
+    const Polygons& collision = per_radius_sample[radius_sample];
+    layer_collision.lock.unlock();
+    return collision;
+}
+
+const Polygons& TreeModelVolumes::getAvoidance(size_t radius_sample, const size_t layer_nr)
+{
+    radius_sample = std::min(radius_sample, radius_sample_count - 1);
+    RadiusAvoidance& radius_avoidance = avoidance_per_radius_sample[radius_sample];
+    radius_avoidance.lock.lock();
+    std::vector<Polygons>& per_layer = radius_avoidance.per_layer;
+    if (per_layer.size() > layer_nr)
+    {
+        radius_avoidance.avoidance_hit_count++;
+    }
+    if (per_layer.empty())
+    {
+        per_layer.reserve(collision_per_layer.size()); //So that the references to the avoidance areas stay valid while higher layers are added.
+        per_layer.push_back(getCollision(radius_sample, 0));
+    }
+    while (per_layer.size() <= layer_nr)
+    {
+        Polygons avoidance = per_layer.back().offset(-maximum_move_distance).smooth(5); //Inset previous layer with maximum_move_distance to allow some movement. Smooth to avoid micrometre-segments.
+        avoidance = avoidance.unionPolygons(getCollision(radius_sample, per_layer.size()));
+        per_layer.push_back(std::move(avoidance));
+    }
+    const Polygons& avoidance = per_layer[layer_nr];
+    radius_avoidance.lock.unlock();
+    return avoidance;
+}
+
+const Polygons& TreeModelVolumes::getInternalGuide(size_t radius_sample, const size_t layer_nr)
+{
+    radius_sample = std::min(radius_sample, radius_sample_count - 1);
+    const Polygons& avoidance = getAvoidance(radius_sample, layer_nr);
+    const Polygons& collision = getCollision(radius_sample, layer_nr);
+    RadiusAvoidance& radius_avoidance = avoidance_per_radius_sample[radius_sample];
+    radius_avoidance.lock.lock();
+    if (radius_avoidance.internal_guide_per_layer.empty())
+    {
+        radius_avoidance.internal_guide_per_layer.resize(collision_per_layer.size());
+        radius_avoidance.has_internal_guide.resize(collision_per_layer.size(), false);
+    }
+    Polygons& internal_guide = radius_avoidance.internal_guide_per_layer[layer_nr];
+    if (!radius_avoidance.has_internal_guide[layer_nr])
+    {
+        internal_guide = avoidance.difference(collision);
+        radius_avoidance.has_internal_guide[layer_nr] = true;
+    }
+    else
+    {
+        radius_avoidance.internal_guide_hit_count++;
+    }
+    radius_avoidance.lock.unlock();
+    return internal_guide;
+}
+
+void TreeModelVolumes::releaseLayer(const size_t layer_nr)
+{
+    LayerCollision& layer_collision = collision_per_layer[layer_nr];
+    layer_collision.outlines = Polygons();
+    for (size_t radius_sample = 1; radius_sample < layer_collision.per_radius_sample.size(); radius_sample++)
+    {
+        layer_collision.per_radius_sample[radius_sample] = Polygons();
+    }
+    for (RadiusAvoidance& radius_avoidance : avoidance_per_radius_sample)
+    {
+        if (radius_avoidance.per_layer.size() > layer_nr)
+        {
+            radius_avoidance.per_layer[layer_nr] = Polygons();
+        }
+        if (radius_avoidance.internal_guide_per_layer.size() > layer_nr)
+        {
+            radius_avoidance.internal_guide_per_layer[layer_nr] = Polygons();
+        }
+    }
+}
+
+void TreeModelVolumes::logUsage() const
+{
+    const size_t area_count = radius_sample_count * collision_per_layer.size();
+    size_t collision_count = 0;
+    size_t collision_hit_count = 0;
+    for (const LayerCollision& layer_collision : collision_per_layer)
+    {
+        collision_count += std::count(layer_collision.has_radius_sample.begin(), layer_collision.has_radius_sample.end(), true);
+        collision_hit_count += layer_collision.hit_count;
+    }
+    size_t avoidance_count = 0;
+    size_t avoidance_hit_count = 0;
+    size_t internal_guide_count = 0;
+    size_t internal_guide_hit_count = 0;
+    for (const RadiusAvoidance& radius_avoidance : avoidance_per_radius_sample)
+    {
+        avoidance_count += radius_avoidance.per_layer.size();
+        avoidance_hit_count += radius_avoidance.avoidance_hit_count;
+        internal_guide_count += std::count(radius_avoidance.has_internal_guide.begin(), radius_avoidance.has_internal_guide.end(), true);
+        internal_guide_hit_count += radius_avoidance.internal_guide_hit_count;
+    }
+    log("Tree support computed %zu collision areas, %zu avoidance areas and %zu internal guides out of %zu each.\n", collision_count, avoidance_count, internal_guide_count, area_count);
+    log("Tree support reused computed collision areas %zu times, avoidance areas %zu times and internal guides %zu times.\n", collision_hit_count, avoidance_hit_count, internal_guide_hit_count);
+}
+
+size_t TreeModelVolumes::getRadiusSampleCount() const
+{
+    return radius_sample_count;
+}
+
+size_t TreeModelVolumes::getLayerCount() const
+{
+    return collision_per_layer.size();
+}
+
+}
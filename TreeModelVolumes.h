@@ -0,0 +1,162 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef TREEMODELVOLUMES_H
+#define TREEMODELVOLUMES_H
+
+#include <vector>
+
+#include "utils/Lock.h"
+#include "utils/NoCopy.h"
+#include "utils/polygon.h"
+
+namespace cura
+{
+
+class SliceDataStorage;
+
+/*!
+ * \brief The volumes of the model which the branches of tree support have to
+ * stay clear of, for each sample of the branch radius.
+ *
+ * The outlines of a layer are computed only once. The collision areas of each
+ * radius sample are offset from them by the full radius, so that no error
+ * accumulates over the radius samples.
+ *
+ * The avoidance areas of a radius are propagated upwards from the collision
+ * areas of the layers below, so each layer is derived from the layer below it.
+ *
+ * All areas are computed the first time they are needed, so the radii which
+ * the branches never reach take no time and no memory. The areas of a layer
+ * which are no longer needed can be released with \ref releaseLayer.
+ */
+class TreeModelVolumes : NoCopy
+{
+public:
+    /*!
+     * \brief Computes the collision areas of the smallest radius sample for
+     * every layer, in parallel over the layers.
+     *
+     * \param storage The data storage to get the layer outlines and the
+     * settings from.
+     * \param machine_volume_border The border of the printer where the branches
+     * may not be placed.
+     */
+    TreeModelVolumes(const SliceDataStorage& storage, const Polygons& machine_volume_border);
+
+    /*!
+     * \brief Get the areas which a branch of a certain radius collides with.
+     *
+     * Thread safe.
+     *
+     * \param radius_sample The sample of the branch radius, i.e. the radius
+     * divided by the radius sample resolution. Radii beyond the largest sample
+     * get the areas of the largest sample.
+     * \param layer_nr The layer to get the collision areas of.
+     * \return The model on that layer, offset by the X/Y distance and the
+     * radius. The reference stays valid as long as the volumes exist.
+     */
+    const Polygons& getCollision(size_t radius_sample, size_t layer_nr);
+
+    /*!
+     * \brief Get the areas which a branch of a certain radius has to avoid in
+     * order to be able to go towards the build plate.
+     *
+     * These are the collision areas, propagated upwards while insetting them by
+     * the maximum move distance of the branches per layer, so that the branches
+     * can predict in time when they need to be moving away in order to avoid
+     * hitting the model.
+     *
+     * Computing the areas of a layer computes those of all layers below it for
+     * the same radius, if they aren't computed yet. Thread safe.
+     *
+     * \param radius_sample The sample of the branch radius. Radii beyond the
+     * largest sample get the areas of the largest sample.
+     * \param layer_nr The layer to get the avoidance areas of.
+     * \return The avoidance areas. The reference stays valid as long as the
+     * volumes exist.
+     */
+    const Polygons& getAvoidance(size_t radius_sample, size_t layer_nr);
+
+    /*!
+     * \brief Get the areas which guide a branch of a certain radius which is
+     * stuck inside the model towards the centre of the model, while avoiding
+     * the model itself.
+     *
+     * Thread safe.
+     *
+     * \param radius_sample The sample of the branch radius. Radii beyond the
+     * largest sample get the areas of the largest sample.
+     * \param layer_nr The layer to get the internal guide of.
+     * \return The avoidance areas minus the collision areas. The reference
+     * stays valid as long as the volumes exist.
+     */
+    const Polygons& getInternalGuide(size_t radius_sample, size_t layer_nr);
+
+    /*!
+     * \brief Free the areas of a layer which the tree support doesn't need
+     * anymore once its nodes are dropped to the layer below.
+     *
+     * Only the collision areas of the smallest radius sample are kept. The
+     * released areas may not be asked for anymore. Not thread safe.
+     *
+     * \param layer_nr The layer to release the areas of.
+     */
+    void releaseLayer(size_t layer_nr);
+
+    /*!
+     * \brief Log how many of the areas were computed, out of all radius
+     * samples of all layers, and how many times an area was asked for again
+     * after it was computed.
+     */
+    void logUsage() const;
+
+    /*!
+     * \brief The number of samples of the branch radius.
+     */
+    size_t getRadiusSampleCount() const;
+
+    /*!
+     * \brief The number of layers the volumes have.
+     */
+    size_t getLayerCount() const;
+
+private:
+    /*!
+     * \brief The collision areas of a layer for the radius samples computed so
+     * far.
+     */
+    struct LayerCollision
+    {
+        Lock lock; //!< Guards the growing of \ref per_radius_sample
+        Polygons outlines; //!< The outlines of the layer and the border of the machine, from which the radius samples are offset. Released with the layer.
+        std::vector<Polygons> per_radius_sample; //!< The collision areas per radius sample, up to the largest sample asked for so far. Never reallocated.
+        std::vector<bool> has_radius_sample; //!< Per radius sample whether its collision areas are computed
+        size_t hit_count = 0; //!< How many times collision areas of this layer were asked for which were already computed
+    };
+
+    /*!
+     * \brief The avoidance areas and internal guides of a radius sample for the
+     * layers computed so far.
+     */
+    struct RadiusAvoidance
+    {
+        Lock lock; //!< Guards the growing of \ref per_layer and the computing of the internal guides
+        std::vector<Polygons> per_layer; //!< The avoidance areas per layer, up to the highest layer asked for so far. Never reallocated.
+        std::vector<Polygons> internal_guide_per_layer; //!< The internal guides per layer, if any is asked for
+        std::vector<bool> has_internal_guide; //!< Per layer whether its internal guide is computed
+        size_t avoidance_hit_count = 0; //!< How many times avoidance areas of this radius were asked for which were already computed
+        size_t internal_guide_hit_count = 0; //!< How many times internal guides of this radius were asked for which were already computed
+    };
+
+    coord_t xy_distance; //!< The distance the branches keep from the model, regardless of their radius
+    coord_t radius_sample_resolution; //!< The difference in radius between consecutive radius samples
+    coord_t maximum_move_distance; //!< The maximum distance a branch moves per layer
+    size_t radius_sample_count; //!< The number of samples of the branch radius
+    std::vector<LayerCollision> collision_per_layer; //!< The collision areas per layer
+    std::vector<RadiusAvoidance> avoidance_per_radius_sample; //!< The avoidance areas per radius sample
+};
+
+}
+
+#endif /* TREEMODELVOLUMES_H */
@@ -1,6 +1,9 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For sorting the nodes of a layer.
+#include <tuple> //For ordering the nodes of a layer.
+
 #include "progress/Progress.h"
 #include "utils/IntPoint.h" //To normalize vectors.
 #include "utils/math.h" //For round_up_divide and PI.
@@ -8,6 +11,7 @@
 #include "utils/polygon.h" //For splitting polygons into parts.
 #include "utils/polygonUtils.h" //For moveInside.
 
+#include "TreeModelVolumes.h"
 #include "TreeSupport.h"
 
 #define SQRT_2 1.4142135623730950488 //Square root of 2.
@@ -15,7 +19,6 @@
 
 //The various stages of the process can be weighted differently in the progress bar.
 //These weights are obtained experimentally.
-#define PROGRESS_WEIGHT_COLLISION 50 //Generating collision areas.
 #define PROGRESS_WEIGHT_DROPDOWN 1 //Dropping down support.
 #define PROGRESS_WEIGHT_AREAS 1 //Creating support areas.
 
@@ -107,20 +110,7 @@ void TreeSupport::generateSupportAreas(SliceDataStorage& storage)
     }
 
     //Generate areas that have to be avoided.
-    std::vector<std::vector<Polygons>> model_collision; //For every sample of branch radius, the areas that have to be avoided by branches of that radius.
-    collisionAreas(storage, model_collision);
-    std::vector<std::vector<Polygons>> model_avoidance; //For every sample of branch radius, the areas that have to be avoided in order to be able to go towards the build plate.
-    propagateCollisionAreas(storage, model_collision, model_avoidance);
-    std::vector<std::vector<Polygons>> model_internal_guide; //A model to guide branches that are stuck inside towards the centre of the model while avoiding the model itself.
-    for (size_t radius_sample = 0; radius_sample < model_avoidance.size(); radius_sample++)
-    {
-        model_internal_guide.emplace_back();
-        for (size_t layer_nr = 0; layer_nr < model_avoidance[radius_sample].size(); layer_nr++)
-        {
-            Polygons layer_internal_guide = model_avoidance[radius_sample][layer_nr].difference(model_collision[radius_sample][layer_nr]);
-            model_internal_guide[radius_sample].push_back(layer_internal_guide);
-        }
-    }
+    TreeModelVolumes volumes(storage, machine_volume_border); //For every sample of branch radius, the areas that have to be avoided by branches of that radius. Computed when the branches first need them.
 
     std::vector<std::unordered_set<Node*>> contact_nodes;
     contact_nodes.reserve(storage.support.supportLayers.size());
@@ -134,14 +124,15 @@ void TreeSupport::generateSupportAreas(SliceDataStorage& storage)
         {
             continue;
         }
-        generateContactPoints(mesh, contact_nodes, model_collision[0]);
+        generateContactPoints(mesh, contact_nodes, volumes);
     }
 
     //Drop nodes to lower layers.
-    dropNodes(storage, contact_nodes, model_collision, model_avoidance, model_internal_guide);
+    dropNodes(storage, contact_nodes, volumes);
 
     //Generate support areas.
-    drawCircles(storage, contact_nodes, model_collision);
+    drawCircles(storage, contact_nodes, volumes);
+    volumes.logUsage();
 
     for (auto& layer : contact_nodes)
     {
@@ -156,39 +147,7 @@ void TreeSupport::generateSupportAreas(SliceDataStorage& storage)
     storage.support.generated = true;
 }
 
-void TreeSupport::collisionAreas(const SliceDataStorage& storage, std::vector<std::vector<Polygons>>& model_collision)
-{
-    const coord_t branch_radius = storage.getSettingInMicrons("support_tree_branch_diameter") / 2;
-    const coord_t layer_height = storage.getSettingInMicrons("layer_height");
-    const double diameter_angle_scale_factor = sin(storage.getSettingInAngleRadians("support_tree_branch_diameter_angle")) * layer_height / branch_radius; //Scale factor per layer to produce the desired angle.
-    const coord_t maximum_radius = branch_radius + storage.support.supportLayers.size() * branch_radius * diameter_angle_scale_factor;
-    const coord_t radius_sample_resolution = storage.getSettingInMicrons("support_tree_collision_resolution");
-    model_collision.resize((size_t)std::round((float)maximum_radius / radius_sample_resolution) + 1);
-
-    const coord_t xy_distance = storage.getSettingInMicrons("support_xy_distance");
-    constexpr bool include_helper_parts = false;
-    size_t completed = 0; //To track progress in a multi-threaded environment.
-#pragma omp parallel for shared(model_collision, storage) schedule(dynamic)
-    for (size_t radius_sample = 0; radius_sample < model_collision.size(); radius_sample++)
-    {
-        const coord_t radius = radius_sample * radius_sample_resolution;
-        for (size_t layer_nr = 0; layer_nr < storage.support.supportLayers.size(); layer_nr++)
-        {
-            Polygons collision = storage.getLayerOutlines(layer_nr, include_helper_parts);
-            collision = collision.unionPolygons(machine_volume_border);
-            collision = collision.offset(xy_distance + radius, ClipperLib::JoinType::jtRound); //Enough space to avoid the (sampled) width of the branch.
-            model_collision[radius_sample].push_back(collision);
-        }
-#pragma omp atomic
-        completed++;
-#pragma omp critical (progress)
-        {
-            Progress::messageProgress(Progress::Stage::SUPPORT, (completed / 2) * PROGRESS_WEIGHT_COLLISION, model_collision.size() * PROGRESS_WEIGHT_COLLISION + storage.support.supportLayers.size() * PROGRESS_WEIGHT_DROPDOWN + storage.support.supportLayers.size() * PROGRESS_WEIGHT_AREAS);
-        }
-    }
-}
-
-void TreeSupport::drawCircles(SliceDataStorage& storage, const std::vector<std::unordered_set<Node*>>& contact_nodes, const std::vector<std::vector<Polygons>>& model_collision)
+void TreeSupport::drawCircles(SliceDataStorage& storage, const std::vector<std::unordered_set<Node*>>& contact_nodes, TreeModelVolumes& volumes)
 {
     const coord_t branch_radius = storage.getSettingInMicrons("support_tree_branch_diameter") / 2;
     const unsigned int wall_count = storage.getSettingAsCount("support_tree_wall_count");
@@ -251,10 +210,10 @@ void TreeSupport::drawCircles(SliceDataStorage& storage, const std::vector<std::
         roof_layer = roof_layer.unionPolygons();
         support_layer = support_layer.difference(roof_layer);
         const size_t z_collision_layer = static_cast<size_t>(std::max(0, static_cast<int>(layer_nr) - static_cast<int>(z_distance_bottom_layers) + 1)); //Layer to test against to create a Z-distance.
-        if (model_collision[0].size() > z_collision_layer)
+        if (volumes.getLayerCount() > z_collision_layer)
         {
-            support_layer = support_layer.difference(model_collision[0][z_collision_layer]); //Subtract the model itself (sample 0 is with 0 diameter but proper X/Y offset).
-            roof_layer = roof_layer.difference(model_collision[0][z_collision_layer]);
+            support_layer = support_layer.difference(volumes.getCollision(0, z_collision_layer)); //Subtract the model itself (sample 0 is with 0 diameter but proper X/Y offset).
+            roof_layer = roof_layer.difference(volumes.getCollision(0, z_collision_layer));
         }
         //We smooth this support as much as possible without altering single circles. So we remove any line less than the side length of those circles.
         const double diameter_angle_scale_factor_this_layer = (double)(storage.support.supportLayers.size() - layer_nr - tip_layers) * diameter_angle_scale_factor; //Maximum scale factor.
@@ -300,12 +259,12 @@ void TreeSupport::drawCircles(SliceDataStorage& storage, const std::vector<std::
         completed++;
 #pragma omp critical (progress)
         {
-            Progress::messageProgress(Progress::Stage::SUPPORT, model_collision.size() * PROGRESS_WEIGHT_COLLISION + contact_nodes.size() * PROGRESS_WEIGHT_DROPDOWN + completed * PROGRESS_WEIGHT_AREAS, model_collision.size() * PROGRESS_WEIGHT_COLLISION + contact_nodes.size() * PROGRESS_WEIGHT_DROPDOWN + contact_nodes.size() * PROGRESS_WEIGHT_AREAS);
+            Progress::messageProgress(Progress::Stage::SUPPORT, contact_nodes.size() * PROGRESS_WEIGHT_DROPDOWN + completed * PROGRESS_WEIGHT_AREAS, contact_nodes.size() * PROGRESS_WEIGHT_DROPDOWN + contact_nodes.size() * PROGRESS_WEIGHT_AREAS);
         }
     }
 }
 
-void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::unordered_set<Node*>>& contact_nodes, const std::vector<std::vector<Polygons>>& model_collision, const std::vector<std::vector<Polygons>>& model_avoidance, const std::vector<std::vector<Polygons>>& model_internal_guide)
+void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::unordered_set<Node*>>& contact_nodes, TreeModelVolumes& volumes)
 {
     //Use Minimum Spanning Tree to connect the points on each layer and move them while dropping them down.
     const coord_t layer_height = storage.getSettingInMicrons("layer_height");
@@ -322,14 +281,24 @@ void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::un
         std::deque<std::pair<size_t, Node*>> unsupported_branch_leaves; // All nodes that are leaves on this layer that would result in unsupported ('mid-air') branches.
 
         //Group together all nodes for each part.
-        std::vector<PolygonsPart> parts = model_avoidance[0][layer_nr].splitIntoParts();
+        std::vector<PolygonsPart> parts = volumes.getAvoidance(0, layer_nr).splitIntoParts();
         std::vector<std::unordered_map<Point, Node*>> nodes_per_part;
         nodes_per_part.emplace_back(); //All nodes that aren't inside a part get grouped together in the 0th part.
         for (size_t part_index = 0; part_index < parts.size(); part_index++)
         {
             nodes_per_part.emplace_back();
         }
-        for (Node* p_node : layer_contact_nodes)
+        //The nodes of the layer are ordered by their address, which depends on the heap. Go over them by position instead so that the result is reproducible.
+        std::vector<Node*> sorted_layer_nodes(layer_contact_nodes.begin(), layer_contact_nodes.end());
+        std::sort(sorted_layer_nodes.begin(), sorted_layer_nodes.end(), [](const Node* a, const Node* b)
+        {
+            if (a->position != b->position)
+            {
+                return a->position.X < b->position.X || (a->position.X == b->position.X && a->position.Y < b->position.Y);
+            }
+            return std::make_tuple(a->distance_to_top, a->support_roof_layers_below, a->to_buildplate, a->skin_direction) < std::make_tuple(b->distance_to_top, b->support_roof_layers_below, b->to_buildplate, b->skin_direction);
+        });
+        for (Node* p_node : sorted_layer_nodes)
         {
             const Node& node = *p_node;
 
@@ -375,11 +344,12 @@ void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::un
             nodes_per_part[closest_part + 1][node.position] = p_node; //Index + 1 because the 0th index is the outside part.
         }
         //Create a MST for every part.
+        //The nodes to merge with are the neighbours of a node in its MST, which finds them with a grid of its own, so the nodes need no separate spatial index here.
         std::vector<MinimumSpanningTree> spanning_trees;
-        for (std::unordered_map<Point, Node*>& group : nodes_per_part)
+        for (const std::unordered_map<Point, Node*>& group : nodes_per_part)
         {
             std::unordered_set<Point> points_to_buildplate;
-            for (const std::pair<Point, Node*>& entry : group)
+            for (const std::pair<const Point, Node*>& entry : group)
             {
                 points_to_buildplate.insert(entry.first); //Just the position of the node.
             }
@@ -391,7 +361,7 @@ void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::un
             const MinimumSpanningTree& mst = spanning_trees[group_index];
             //In the first pass, merge all nodes that are close together.
             std::unordered_set<Node*> to_delete;
-            for (const std::pair<Point, Node*>& entry : nodes_per_part[group_index])
+            for (const std::pair<const Point, Node*>& entry : nodes_per_part[group_index])
             {
                 Node* p_node = entry.second;
                 const Node& node = *p_node;
@@ -399,7 +369,7 @@ void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::un
                 {
                     continue; //Delete this node (don't create a new node for it on the next layer).
                 }
-                const std::vector<Point>& neighbours = mst.adjacentNodes(node.position);
+                const MinimumSpanningTree::AdjacentNodes neighbours = mst.adjacentNodes(node.position);
                 if (neighbours.size() == 1 && vSize2(neighbours[0] - node.position) < maximum_move_distance * maximum_move_distance && mst.adjacentNodes(neighbours[0]).size() == 1) //We have just two nodes left, and they're very close!
                 {
                     //Insert a completely new node and let both original nodes fade.
@@ -411,16 +381,16 @@ void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::un
                     {
                         //Avoid collisions.
                         const coord_t maximum_move_between_samples = maximum_move_distance + radius_sample_resolution + 100; //100 micron extra for rounding errors.
-                        PolygonUtils::moveOutside(model_avoidance[branch_radius_sample][layer_nr - 1], next_position, radius_sample_resolution + 100, maximum_move_between_samples * maximum_move_between_samples); //Some extra offset to prevent rounding errors with the sample resolution.
+                        PolygonUtils::moveOutside(volumes.getAvoidance(branch_radius_sample, layer_nr - 1), next_position, radius_sample_resolution + 100, maximum_move_between_samples * maximum_move_between_samples); //Some extra offset to prevent rounding errors with the sample resolution.
                     }
                     else
                     {
                         //Move towards centre of polygon.
-                        const ClosestPolygonPoint closest_point_on_border = PolygonUtils::findClosest(node.position, model_internal_guide[branch_radius_sample][layer_nr - 1]);
+                        const ClosestPolygonPoint closest_point_on_border = PolygonUtils::findClosest(node.position, volumes.getInternalGuide(branch_radius_sample, layer_nr - 1));
                         const coord_t distance = vSize(node.position - closest_point_on_border.location);
                         //Try moving a bit further inside: Current distance + 1 step.
                         Point moved_inside = next_position;
-                        PolygonUtils::ensureInsideOrOutside(model_internal_guide[branch_radius_sample][layer_nr - 1], moved_inside, closest_point_on_border, distance + maximum_move_distance);
+                        PolygonUtils::ensureInsideOrOutside(volumes.getInternalGuide(branch_radius_sample, layer_nr - 1), moved_inside, closest_point_on_border, distance + maximum_move_distance);
                         Point difference = moved_inside - node.position;
                         if(vSize2(difference) > maximum_move_distance * maximum_move_distance)
                         {
@@ -429,7 +399,7 @@ void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::un
                         next_position = node.position + difference;
                     }
 
-                    const bool to_buildplate = !model_avoidance[branch_radius_sample][layer_nr - 1].inside(next_position);
+                    const bool to_buildplate = !volumes.getAvoidance(branch_radius_sample, layer_nr - 1).inside(next_position);
                     Node* next_node = new Node(next_position, node.distance_to_top + 1, node.skin_direction, node.support_roof_layers_below - 1, to_buildplate, p_node);
                     insertDroppedNode(contact_nodes[layer_nr - 1], next_node); //Insert the node, resolving conflicts of the two colliding nodes.
 
@@ -457,7 +427,7 @@ void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::un
                 }
             }
             //In the second pass, move all middle nodes.
-            for (std::pair<Point, Node*> entry : nodes_per_part[group_index])
+            for (const std::pair<const Point, Node*>& entry : nodes_per_part[group_index])
             {
                 Node* p_node = entry.second;
                 const Node& node = *p_node;
@@ -466,10 +436,10 @@ void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::un
                     continue;
                 }
                 //If the branch falls completely inside a collision area (the entire branch would be removed by the X/Y offset), delete it.
-                if (group_index > 0 && model_collision[0][layer_nr].inside(node.position))
+                if (group_index > 0 && volumes.getCollision(0, layer_nr).inside(node.position))
                 {
                     const coord_t branch_radius_node = (node.distance_to_top > tip_layers) ? (branch_radius + branch_radius * node.distance_to_top * diameter_angle_scale_factor) : (branch_radius * node.distance_to_top / tip_layers);
-                    const ClosestPolygonPoint to_outside = PolygonUtils::findClosest(node.position, model_collision[0][layer_nr]);
+                    const ClosestPolygonPoint to_outside = PolygonUtils::findClosest(node.position, volumes.getCollision(0, layer_nr));
                     if (vSize2(node.position - to_outside.location) >= branch_radius_node * branch_radius_node) //Too far inside.
                     {
                         unsupported_branch_leaves.push_front({layer_nr, p_node});
@@ -477,7 +447,7 @@ void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::un
                     }
                 }
                 Point next_layer_vertex = node.position;
-                std::vector<Point> neighbours = mst.adjacentNodes(node.position);
+                const MinimumSpanningTree::AdjacentNodes neighbours = mst.adjacentNodes(node.position);
                 if (neighbours.size() > 1 || (neighbours.size() == 1 && vSize2(neighbours[0] - node.position) >= maximum_move_distance * maximum_move_distance)) //Only nodes that aren't about to collapse.
                 {
                     //Move towards the average position of all neighbours.
@@ -502,16 +472,16 @@ void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::un
                 {
                     //Avoid collisions.
                     const coord_t maximum_move_between_samples = maximum_move_distance + radius_sample_resolution + 100; //100 micron extra for rounding errors.
-                    PolygonUtils::moveOutside(model_avoidance[branch_radius_sample][layer_nr - 1], next_layer_vertex, radius_sample_resolution + 100, maximum_move_between_samples * maximum_move_between_samples); //Some extra offset to prevent rounding errors with the sample resolution.
+                    PolygonUtils::moveOutside(volumes.getAvoidance(branch_radius_sample, layer_nr - 1), next_layer_vertex, radius_sample_resolution + 100, maximum_move_between_samples * maximum_move_between_samples); //Some extra offset to prevent rounding errors with the sample resolution.
                 }
                 else
                 {
                     //Move towards centre of polygon.
-                    const ClosestPolygonPoint closest_point_on_border = PolygonUtils::findClosest(next_layer_vertex, model_internal_guide[branch_radius_sample][layer_nr - 1]);
+                    const ClosestPolygonPoint closest_point_on_border = PolygonUtils::findClosest(next_layer_vertex, volumes.getInternalGuide(branch_radius_sample, layer_nr - 1));
                     const coord_t distance = vSize(node.position - closest_point_on_border.location);
                     //Try moving a bit further inside: Current distance + 1 step.
                     Point moved_inside = next_layer_vertex;
-                    PolygonUtils::ensureInsideOrOutside(model_internal_guide[branch_radius_sample][layer_nr - 1], moved_inside, closest_point_on_border, distance + maximum_move_distance);
+                    PolygonUtils::ensureInsideOrOutside(volumes.getInternalGuide(branch_radius_sample, layer_nr - 1), moved_inside, closest_point_on_border, distance + maximum_move_distance);
                     Point difference = moved_inside - node.position;
                     if(vSize2(difference) > maximum_move_distance * maximum_move_distance)
                     {
@@ -520,7 +490,7 @@ void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::un
                     next_layer_vertex = node.position + difference;
                 }
 
-                const bool to_buildplate = !model_avoidance[branch_radius_sample][layer_nr - 1].inside(next_layer_vertex);
+                const bool to_buildplate = !volumes.getAvoidance(branch_radius_sample, layer_nr - 1).inside(next_layer_vertex);
                 Node* next_node = new Node(next_layer_vertex, node.distance_to_top + 1, node.skin_direction, node.support_roof_layers_below - 1, to_buildplate, p_node);
                 insertDroppedNode(contact_nodes[layer_nr - 1], next_node);
             }
@@ -548,11 +518,13 @@ void TreeSupport::dropNodes(const SliceDataStorage& storage, std::vector<std::un
         }
         to_free.clear();
 
-        Progress::messageProgress(Progress::Stage::SUPPORT, model_avoidance.size() * PROGRESS_WEIGHT_COLLISION + (contact_nodes.size() - layer_nr) * PROGRESS_WEIGHT_DROPDOWN, model_avoidance.size() * PROGRESS_WEIGHT_COLLISION + contact_nodes.size() * PROGRESS_WEIGHT_DROPDOWN + contact_nodes.size() * PROGRESS_WEIGHT_AREAS);
+        volumes.releaseLayer(layer_nr); //Only the lower layers are dropped to from here on. Drawing the circles just needs the collision areas without radius.
+
+        Progress::messageProgress(Progress::Stage::SUPPORT, (contact_nodes.size() - layer_nr) * PROGRESS_WEIGHT_DROPDOWN, contact_nodes.size() * PROGRESS_WEIGHT_DROPDOWN + contact_nodes.size() * PROGRESS_WEIGHT_AREAS);
     }
 }
 
-void TreeSupport::generateContactPoints(const SliceMeshStorage& mesh, std::vector<std::unordered_set<TreeSupport::Node*>>& contact_nodes, const std::vector<Polygons>& collision_areas)
+void TreeSupport::generateContactPoints(const SliceMeshStorage& mesh, std::vector<std::unordered_set<TreeSupport::Node*>>& contact_nodes, TreeModelVolumes& volumes)
 {
     const coord_t point_spread = mesh.getSettingInMicrons("support_tree_branch_distance");
 
@@ -606,7 +578,7 @@ void TreeSupport::generateContactPoints(const SliceMeshStorage& mesh, std::vecto
                     constexpr coord_t distance_inside = 0; //Move point towards the border of the polygon if it is closer than half the overhang distance: Catch points that fall between overhang areas on constant surfaces.
                     PolygonUtils::moveInside(overhang_part, candidate, distance_inside, half_overhang_distance * half_overhang_distance);
                     constexpr bool border_is_inside = true;
-                    if (overhang_part.inside(candidate, border_is_inside) && !collision_areas[layer_nr].inside(candidate, border_is_inside))
+                    if (overhang_part.inside(candidate, border_is_inside) && !volumes.getCollision(0, layer_nr).inside(candidate, border_is_inside))
                     {
                         constexpr size_t distance_to_top = 0;
                         constexpr bool to_buildplate = true;
@@ -643,31 +615,4 @@ void TreeSupport::insertDroppedNode(std::unordered_set<Node*>& nodes_layer, Node
     conflicting_node->support_roof_layers_below = std::max(conflicting_node->support_roof_layers_below, p_node->support_roof_layers_below);
 }
 
-void TreeSupport::propagateCollisionAreas(const SliceDataStorage& storage, const std::vector<std::vector<Polygons>>& model_collision, std::vector<std::vector<Polygons>>& model_avoidance)
-{
-    model_avoidance.resize(model_collision.size());
-
-    const coord_t layer_height = storage.getSettingInMicrons("layer_height");
-    const double angle = storage.getSettingInAngleRadians("support_tree_angle");
-    const coord_t maximum_move_distance = angle < 90 ? (coord_t)(tan(angle) * layer_height) : std::numeric_limits<coord_t>::max();
-    size_t completed = 0; //To track progress in a multi-threaded environment.
-#pragma omp parallel for shared(model_avoidance) schedule(dynamic)
-    for (size_t radius_sample = 0; radius_sample < model_avoidance.size(); radius_sample++)
-    {
-        model_avoidance[radius_sample].push_back(model_collision[radius_sample][0]);
-        for (size_t layer_nr = 1; layer_nr < storage.support.supportLayers.size(); layer_nr++)
-        {
-            Polygons previous_layer = model_avoidance[radius_sample][layer_nr - 1].offset(-maximum_move_distance).smooth(5); //Inset previous layer with maximum_move_distance to allow some movement. Smooth to avoid micrometre-segments.
-            previous_layer = previous_layer.unionPolygons(model_collision[radius_sample][layer_nr]);
-            model_avoidance[radius_sample].push_back(previous_layer);
-        }
-#pragma omp atomic
-        completed++;
-#pragma omp critical (progress)
-        {
-            Progress::messageProgress(Progress::Stage::SUPPORT, ((model_collision.size() / 2) + (completed / 2)) * PROGRESS_WEIGHT_COLLISION, model_avoidance.size() * PROGRESS_WEIGHT_COLLISION + storage.support.supportLayers.size() * PROGRESS_WEIGHT_DROPDOWN + storage.support.supportLayers.size() * PROGRESS_WEIGHT_AREAS);
-        }
-    }
-}
-
 }
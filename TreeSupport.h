@@ -8,6 +8,7 @@
 #include <unordered_set>
 
 #include "sliceDataStorage.h"
+#include "TreeModelVolumes.h"
 
 namespace cura
 {
@@ -122,23 +123,6 @@ private:
      */
     Polygons machine_volume_border;
 
-    /*!
-     * \brief Creates the areas that have to be avoided by the tree's branches.
-     *
-     * The result is a vector of 3D volumes that have to be avoided, where each
-     * volume consists of a number of layers where the branch would collide with
-     * the model.
-     * There will be a volume for each sample of branch radius. The radii of the
-     * branches are unknown at this point (there will be several radii at any
-     * given layer too), so a collision area is generated for every possible
-     * radius.
-     *
-     * \param storage The settings storage to get settings from.
-     * \param model_collision[out] A vector to fill with the output collision
-     * areas.
-     */
-    void collisionAreas(const SliceDataStorage& storage, std::vector<std::vector<Polygons>>& model_collision);
-
     /*!
      * \brief Draws circles around each node of the tree into the final support.
      *
@@ -148,10 +132,10 @@ private:
      * \param storage[in, out] The settings storage to get settings from and to
      * save the resulting support polygons to.
      * \param contact_nodes The nodes to draw as support.
-     * \param model_collision The model infill with the X/Y distance already
-     * subtracted.
+     * \param volumes The collision areas of the model, of which the smallest
+     * radius sample is the model with the X/Y distance already added.
      */
-    void drawCircles(SliceDataStorage& storage, const std::vector<std::unordered_set<Node*>>& contact_nodes, const std::vector<std::vector<Polygons>>& model_collision);
+    void drawCircles(SliceDataStorage& storage, const std::vector<std::unordered_set<Node*>>& contact_nodes, TreeModelVolumes& volumes);
 
     /*!
      * \brief Drops down the nodes of the tree support towards the build plate.
@@ -165,17 +149,13 @@ private:
      * \param contact_nodes[in, out] The nodes in the space that need to be
      * dropped down. The nodes are dropped to lower layers inside the same
      * vector of layers.
-     * \param model_collision For each sample of radius, a list of layers with
-     * the polygons of the collision areas of the model. Any node in there will
-     * collide with the model.
-     * \param model_avoidance For each sample of radius, a list of layers with
-     * the polygons that must be avoided if the branches wish to go towards the
-     * build plate.
-     * \param model_internal_guide For each sample of radius, a list of layers
-     * with the polygons that must be avoided if the branches wish to go towards
-     * the model.
+     * \param volumes The areas of the model for each sample of radius: the
+     * collision areas, where any node will collide with the model, the
+     * avoidance areas, which must be avoided if the branches wish to go towards
+     * the build plate, and the internal guides, which must be avoided if the
+     * branches wish to go towards the model.
      */
-    void dropNodes(const SliceDataStorage& storage, std::vector<std::unordered_set<Node*>>& contact_nodes, const std::vector<std::vector<Polygons>>& model_collision, const std::vector<std::vector<Polygons>>& model_avoidance, const std::vector<std::vector<Polygons>>& model_internal_guide);
+    void dropNodes(const SliceDataStorage& storage, std::vector<std::unordered_set<Node*>>& contact_nodes, TreeModelVolumes& volumes);
 
     /*!
      * \brief Creates points where support contacts the model.
@@ -184,13 +164,13 @@ private:
      * \param mesh The mesh to get the overhang areas to support of.
      * \param contact_nodes[out] A vector of mappings from contact points to
      * their tree nodes.
-     * \param collision_areas For every layer, the areas where a generated
-     * contact point would immediately collide with the model due to the X/Y
-     * distance.
+     * \param volumes The collision areas of the model, of which the smallest
+     * radius sample is where a generated contact point would immediately
+     * collide with the model due to the X/Y distance.
      * \return For each layer, a list of points where the tree should connect
      * with the model.
      */
-    void generateContactPoints(const SliceMeshStorage& mesh, std::vector<std::unordered_set<Node*>>& contact_nodes, const std::vector<Polygons>& collision_areas);
+    void generateContactPoints(const SliceMeshStorage& mesh, std::vector<std::unordered_set<Node*>>& contact_nodes, TreeModelVolumes& volumes);
 
     /*!
      * \brief Add a node to the next layer.
@@ -198,30 +178,6 @@ private:
      * If a node is already at that position in the layer, the nodes are merged.
      */
     void insertDroppedNode(std::unordered_set<Node*>& nodes_layer, Node* node);
-
-    /*!
-     * \brief Creates the areas that have to be avoided by the tree's branches
-     * in order to reach the build plate.
-     *
-     * The result is a vector of 3D volumes that have to be avoided, where each
-     * volume consists of a number of layers where the branch would collide with
-     * the model.
-     * There will be a volume for each sample of branch radius. The radii of the
-     * branches are unknown at this point (there will be several radii at any
-     * given layer too), so a collision area is generated for every possible
-     * radius.
-     *
-     * The input collision areas are inset by the maximum move distance and
-     * propagated upwards. This generates volumes so that the branches can
-     * predict in time when they need to be moving away in order to avoid
-     * hitting the model.
-     * \param storage The settings storage to get settings from.
-     * \param model_collision The collision areas that may not be hit by the
-     * model.
-     * \param model_avoidance[out] A vector to fill with the output avoidance
-     * areas.
-     */
-    void propagateCollisionAreas(const SliceDataStorage& storage, const std::vector<std::vector<Polygons>>& model_collision, std::vector<std::vector<Polygons>>& model_avoidance);
 };
 
 }
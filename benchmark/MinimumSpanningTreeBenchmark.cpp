@@ -0,0 +1,217 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+/*
+ * Standalone benchmark of MinimumSpanningTree against the previous implementation, Prim's algorithm on all edges of the
+ * clique with hash maps, which is kept here as the reference.
+ *
+ * For each input it checks that both trees span all vertices and have the same sorted edge lengths, i.e. the same total
+ * length. Only edges of equal length may be chosen differently.
+ *
+ * Build and run from the root of the repository:
+ *   g++ -O2 -std=c++11 -I. benchmark/MinimumSpanningTreeBenchmark.cpp utils/MinimumSpanningTree.cpp utils/clipper.cpp -o mst_benchmark
+ *   ./mst_benchmark [point_sets.txt]
+ *
+ * The optional file has one set of points per line: the number of points followed by the X and Y coordinate of each.
+ * The exit code is 1 if any tree differs from the reference.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "utils/MinimumSpanningTree.h"
+
+using namespace cura;
+
+/*!
+ * The previous implementation: Prim's algorithm on all edges of the clique, O(V^2) with hash map lookups.
+ */
+class ReferenceMinimumSpanningTree
+{
+public:
+    ReferenceMinimumSpanningTree(const std::unordered_set<Point>& vertices)
+    {
+        if (vertices.empty())
+        {
+            return;
+        }
+        std::vector<Point> vertices_list(vertices.begin(), vertices.end());
+        adjacency[vertices_list[0]];
+        std::unordered_map<Point*, coord_t> smallest_distance;
+        std::unordered_map<Point*, Point*> smallest_distance_to;
+        for (size_t vertex_idx = 1; vertex_idx < vertices_list.size(); vertex_idx++)
+        {
+            smallest_distance[&vertices_list[vertex_idx]] = vSize2(vertices_list[vertex_idx] - vertices_list[0]);
+            smallest_distance_to[&vertices_list[vertex_idx]] = &vertices_list[0];
+        }
+        while (adjacency.size() < vertices_list.size())
+        {
+            Point* closest_point = nullptr;
+            coord_t closest_distance = std::numeric_limits<coord_t>::max();
+            for (const std::pair<Point* const, coord_t>& point_and_distance : smallest_distance)
+            {
+                if (point_and_distance.second < closest_distance)
+                {
+                    closest_point = point_and_distance.first;
+                    closest_distance = point_and_distance.second;
+                }
+            }
+            const Point other_end = *smallest_distance_to[closest_point];
+            adjacency[*closest_point].push_back(other_end);
+            adjacency[other_end].push_back(*closest_point);
+            smallest_distance.erase(closest_point);
+            smallest_distance_to.erase(closest_point);
+            for (std::pair<Point* const, coord_t>& point_and_distance : smallest_distance)
+            {
+                const coord_t new_distance = vSize2(*closest_point - *point_and_distance.first);
+                if (new_distance < point_and_distance.second)
+                {
+                    point_and_distance.second = new_distance;
+                    smallest_distance_to[point_and_distance.first] = closest_point;
+                }
+            }
+        }
+    }
+
+    std::unordered_map<Point, std::vector<Point>> adjacency;
+};
+
+/*!
+ * The sorted squared lengths of the edges of a tree, each edge once, or an empty list if the tree doesn't span all vertices.
+ */
+static std::vector<coord_t> getEdgeLengths(const MinimumSpanningTree& tree, const std::unordered_set<Point>& vertices)
+{
+    std::vector<coord_t> result;
+    for (const Point& vertex : vertices)
+    {
+        for (const Point& adjacent : tree.adjacentNodes(vertex))
+        {
+            if (vertex.X < adjacent.X || (vertex.X == adjacent.X && vertex.Y < adjacent.Y))
+            {
+                result.push_back(vSize2(vertex - adjacent));
+            }
+        }
+    }
+    if (result.size() + 1 != vertices.size() && !vertices.empty())
+    {
+        return std::vector<coord_t>();
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+static std::vector<coord_t> getEdgeLengths(const ReferenceMinimumSpanningTree& tree)
+{
+    std::vector<coord_t> result;
+    for (const std::pair<const Point, std::vector<Point>>& vertex : tree.adjacency)
+    {
+        for (const Point& adjacent : vertex.second)
+        {
+            if (vertex.first.X < adjacent.X || (vertex.first.X == adjacent.X && vertex.first.Y < adjacent.Y))
+            {
+                result.push_back(vSize2(vertex.first - adjacent));
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/*!
+ * Times both implementations on a set of points and compares the trees.
+ *
+ * \return Whether the trees have the same edge lengths.
+ */
+static bool benchmark(const char* name, const std::unordered_set<Point>& vertices)
+{
+    const size_t repetitions = std::max(size_t(1), size_t(200000) / std::max(vertices.size() * vertices.size() / 50, size_t(1)));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t repetition = 0; repetition < repetitions; repetition++)
+    {
+        ReferenceMinimumSpanningTree reference(vertices);
+    }
+    const double reference_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repetitions;
+    start = std::chrono::steady_clock::now();
+    for (size_t repetition = 0; repetition < repetitions; repetition++)
+    {
+        MinimumSpanningTree tree(vertices);
+    }
+    const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repetitions;
+
+    const bool is_equal = getEdgeLengths(MinimumSpanningTree(vertices), vertices) == getEdgeLengths(ReferenceMinimumSpanningTree(vertices));
+    printf("%-10s n=%6zu  reference %10.6fs  new %10.6fs  speedup %6.1fx  %s\n", name, vertices.size(), reference_time, time, reference_time / time, is_equal ? "equal length" : "DIFFERENT LENGTH");
+    return is_equal;
+}
+
+int main(int argc, char** argv)
+{
+    bool is_all_equal = true;
+    std::mt19937 random(1);
+    std::uniform_int_distribution<coord_t> coordinate(0, 200000);
+    std::normal_distribution<double> cluster_spread(0, 3000);
+    for (const size_t count : {10, 30, 100, 300, 1000, 4000, 10000})
+    {
+        std::unordered_set<Point> uniform;
+        while (uniform.size() < count)
+        {
+            uniform.emplace(coordinate(random), coordinate(random));
+        }
+        is_all_equal &= benchmark("uniform", uniform);
+
+        std::unordered_set<Point> clustered;
+        while (clustered.size() < count)
+        {
+            const coord_t cluster = random() % 5;
+            clustered.emplace(cluster * 40000 + (coord_t)cluster_spread(random), (cluster % 2) * 60000 + (coord_t)cluster_spread(random));
+        }
+        is_all_equal &= benchmark("clustered", clustered);
+
+        std::unordered_set<Point> lattice; //Many edges of equal length, like the contact points of tree support.
+        const size_t side = (size_t)std::sqrt((double)count) + 1;
+        for (size_t index = 0; index < count; index++)
+        {
+            lattice.emplace((index % side) * 2000, (index / side) * 2000);
+        }
+        is_all_equal &= benchmark("lattice", lattice);
+
+        std::unordered_set<Point> line;
+        while (line.size() < count)
+        {
+            line.emplace(coordinate(random) * 5, 7);
+        }
+        is_all_equal &= benchmark("line", line);
+    }
+
+    if (argc > 1)
+    {
+        std::ifstream file(argv[1]);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::istringstream stream(line);
+            size_t count;
+            stream >> count;
+            std::unordered_set<Point> points;
+            long long x, y;
+            while (stream >> x >> y)
+            {
+                points.emplace(x, y);
+            }
+            if (points.size() > 1)
+            {
+                is_all_equal &= benchmark("file", points);
+            }
+        }
+    }
+    return is_all_equal ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+/*
+ * Standalone benchmark of the sliding window of the skin computation (skin_window_algorithm = sliding_window) against
+ * intersecting the walls of the layers above and below each layer from scratch (per_layer).
+ *
+ * Two meshes are built layer by layer. The first is a stepped block with a hole halfway up, so that there are skins at
+ * many heights. The second adds a tower with a flange and a pillar which starts and stops between the others, so that
+ * there are several parts per layer; the window is only used for parts which overlap all parts of the layers above or
+ * below, so on that mesh most parts fall back to the intersection per layer. The walls are generated once per run; only
+ * the skin and infill computation of all layers is timed. Both runs have to give exactly the same skin and infill areas.
+ *
+ * Build and run from the root of the repository, linking all sources of the engine except main.cpp and the socket:
+ *   g++ -O2 -std=c++11 -fopenmp -I. benchmark/SkinWindowBenchmark.cpp $(find . -maxdepth 2 -name "*.cpp" ! -path "./benchmark*" ! -name main.cpp ! -name "*ocket.cpp") -o skin_window_benchmark
+ *   ./skin_window_benchmark [repetitions]
+ *
+ * The exit code is 1 if the areas differ.
+ */
+
+#include <algorithm> //For std::max.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "MeshGroup.h"
+#include "WallsComputation.h"
+#include "settings/SettingRegistry.h"
+#include "skin.h"
+#include "sliceDataStorage.h"
+
+using namespace cura;
+
+constexpr unsigned int layer_count = 240;
+constexpr coord_t layer_thickness = 100;
+
+/*!
+ * The settings which the walls and the skin computation read, for one extruder. They are registered by \ref createExtruderTrain.
+ */
+static const char* const settings[][2] = {
+    {"machine_extruder_count", "1"},
+    {"machine_width", "200"}, {"machine_depth", "200"}, {"machine_height", "200"}, {"machine_center_is_zero", "False"},
+    {"prime_tower_enable", "False"}, {"prime_tower_min_volume", "0"}, {"prime_tower_size", "0"}, {"material_adhesion_tendency", "0"},
+    {"initial_layer_line_width_factor", "100"},
+    {"wall_line_count", "3"}, {"wall_line_width_0", "0.4"}, {"wall_line_width_x", "0.4"}, {"wall_0_inset", "0"},
+    {"wall_0_extruder_nr", "0"}, {"wall_x_extruder_nr", "0"}, {"top_bottom_extruder_nr", "0"}, {"infill_extruder_nr", "0"},
+    {"top_layers", "8"}, {"bottom_layers", "8"}, {"roofing_layer_count", "2"},
+    {"skin_line_width", "0.4"}, {"skin_outline_count", "1"}, {"skin_overlap_mm", "0.02"},
+    {"skin_no_small_gaps_heuristic", "False"}, {"skin_preshrink", "0.8"}, {"top_skin_preshrink", "0.8"}, {"bottom_skin_preshrink", "0.8"},
+    {"expand_skins_expand_distance", "0.8"}, {"top_skin_expand_distance", "0.8"}, {"bottom_skin_expand_distance", "0.8"},
+    {"max_skin_angle_for_expansion", "90"}, {"min_skin_width_for_expansion", "0"},
+    {"infill_line_distance", "4"}, {"infill_line_width", "0.4"}, {"infill_pattern", "grid"}, {"infill_sparse_thickness", "0.1"},
+    {"infill_wall_line_count", "0"}, {"infill_overlap_mm", "0.04"}, {"infill_mesh", "False"}, {"infill_support_enabled", "False"},
+    {"fill_perimeter_gaps", "everywhere"}, {"magic_spiralize", "False"}, {"magic_mesh_surface_mode", "normal"},
+    {"spaghetti_infill_enabled", "False"}, {"min_infill_area", "0"}, {"infill_support_angle", "40"},
+    {"gradual_infill_steps", "0"}, {"gradual_infill_step_height", "1.5"}, {"infill_sparse_density", "20"},
+    {"layer_height", "0.1"}, {"layer_height_0", "0.1"},
+};
+
+/*!
+ * A regular polygon approximating a circle.
+ */
+static Polygon circle(const Point center, const coord_t radius)
+{
+    Polygon result;
+    constexpr int corner_count = 64;
+    for (int corner_idx = 0; corner_idx < corner_count; corner_idx++)
+    {
+        const double angle = 2 * M_PI * corner_idx / corner_count;
+        result.add(center + Point(radius * std::cos(angle), radius * std::sin(angle)));
+    }
+    return result;
+}
+
+/*!
+ * An axis aligned square.
+ */
+static Polygon square(const Point center, const coord_t half_side)
+{
+    Polygon result;
+    result.add(center + Point(-half_side, -half_side));
+    result.add(center + Point(half_side, -half_side));
+    result.add(center + Point(half_side, half_side));
+    result.add(center + Point(-half_side, half_side));
+    return result;
+}
+
+/*!
+ * The outline of a test mesh at a layer.
+ *
+ * \param layer_nr The layer
+ * \param has_several_parts Whether to add a tower and a pillar next to the block
+ */
+static Polygons getLayerOutline(const unsigned int layer_nr, const bool has_several_parts)
+{
+    Polygons block;
+    block.add(square(Point(50000, 50000), 20000 - 2000 * (layer_nr / 30))); // a top skin every 30 layers
+    if (layer_nr >= 60 && layer_nr < 150)
+    { // a hole halfway up, with a top skin below and a bottom skin above it
+        Polygons hole;
+        hole.add(square(Point(50000, 50000), 5000));
+        block = block.difference(hole);
+    }
+    if (!has_several_parts)
+    {
+        return block;
+    }
+    Polygons tower;
+    if (layer_nr < 200)
+    {
+        tower.add(circle(Point(110000, 50000), (layer_nr >= 100 && layer_nr < 120) ? 14000 : 8000)); // the flange overhangs
+    }
+    Polygons pillar;
+    if (layer_nr >= 40 && layer_nr < 180)
+    {
+        pillar.add(square(Point(110000, 100000), 4000 + 100 * (layer_nr % 20))); // small steps in between the top layers
+    }
+    return block.unionPolygons(tower).unionPolygons(pillar);
+}
+
+/*!
+ * Build the layers of a test mesh with their walls.
+ */
+static void generateLayers(SliceMeshStorage& mesh, const bool has_several_parts)
+{
+    mesh.layers.resize(layer_count);
+    for (unsigned int layer_nr = 0; layer_nr < layer_count; layer_nr++)
+    {
+        SliceLayer& layer = mesh.layers[layer_nr];
+        layer.printZ = layer_thickness * (layer_nr + 1);
+        layer.thickness = layer_thickness;
+        for (const PolygonsPart& outline_part : getLayerOutline(layer_nr, has_several_parts).splitIntoParts())
+        {
+            layer.parts.emplace_back();
+            layer.parts.back().outline = outline_part;
+            layer.parts.back().boundaryBox.calculate(outline_part);
+        }
+        WallsComputation walls_computation(mesh.getSettingInMicrons("wall_0_inset"), mesh.getSettingInMicrons("wall_line_width_0"), mesh.getSettingInMicrons("wall_line_width_x"), mesh.getSettingAsCount("wall_line_count"), false, false);
+        walls_computation.generateInsets(&layer);
+    }
+    mesh.layer_nr_max_filled_layer = layer_count - 1;
+}
+
+/*!
+ * Compute the skin and infill of all layers, with or without the sliding window.
+ *
+ * \return The time it took
+ */
+static double computeSkins(const SliceDataStorage& storage, SliceMeshStorage& mesh, const bool use_sliding_window)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SkinWallsCache walls_cache(mesh);
+    SkinNotAirWindows not_air_windows;
+    if (use_sliding_window)
+    { // computed with the line widths of the second layer, like FffPolygonGenerator does
+        SkinInfillAreaComputation(1, storage, mesh, true).generateNotAirWindows(not_air_windows);
+    }
+    for (unsigned int layer_nr = 0; layer_nr < mesh.layers.size(); layer_nr++)
+    {
+        SkinInfillAreaComputation(layer_nr, storage, mesh, true, &walls_cache, &not_air_windows).generateSkinsAndInfill();
+        walls_cache.finishLayer(layer_nr);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool isEqual(const Polygons& a, const Polygons& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (unsigned int poly_idx = 0; poly_idx < a.size(); poly_idx++)
+    {
+        if (a[poly_idx].size() != b[poly_idx].size())
+        {
+            return false;
+        }
+        for (unsigned int point_idx = 0; point_idx < a[poly_idx].size(); point_idx++)
+        {
+            if (a[poly_idx][point_idx] != b[poly_idx][point_idx])
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool isEqual(const std::vector<Polygons>& a, const std::vector<Polygons>& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (unsigned int idx = 0; idx < a.size(); idx++)
+    {
+        if (!isEqual(a[idx], b[idx]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * Compare the skin and infill areas of a layer of two meshes.
+ */
+static bool isEqual(const SliceLayer& a, const SliceLayer& b)
+{
+    if (a.parts.size() != b.parts.size())
+    {
+        return false;
+    }
+    for (unsigned int part_idx = 0; part_idx < a.parts.size(); part_idx++)
+    {
+        const SliceLayerPart& part_a = a.parts[part_idx];
+        const SliceLayerPart& part_b = b.parts[part_idx];
+        if (!isEqual(part_a.infill_area, part_b.infill_area) || !isEqual(part_a.perimeter_gaps, part_b.perimeter_gaps) || part_a.skin_parts.size() != part_b.skin_parts.size())
+        {
+            return false;
+        }
+        for (unsigned int skin_idx = 0; skin_idx < part_a.skin_parts.size(); skin_idx++)
+        {
+            const SkinPart& skin_a = part_a.skin_parts[skin_idx];
+            const SkinPart& skin_b = part_b.skin_parts[skin_idx];
+            if (!isEqual(skin_a.outline, skin_b.outline) || !isEqual(skin_a.insets, skin_b.insets) || !isEqual(skin_a.perimeter_gaps, skin_b.perimeter_gaps)
+                || !isEqual(skin_a.inner_infill, skin_b.inner_infill) || !isEqual(skin_a.roofing_fill, skin_b.roofing_fill))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*!
+ * Create the extruder train of the mesh group from a machine definition with one extruder, written to the temporary directory.
+ * The definition registers the benchmark settings with their values.
+ */
+static bool createExtruderTrain(MeshGroup& meshgroup, SettingsBase& machine_settings)
+{
+    const char* temporary_directory = std::getenv("TMPDIR");
+    const std::string directory = temporary_directory ? temporary_directory : "/tmp";
+    const std::string machine_file = directory + "/skin_window_benchmark.def.json";
+    const std::string extruder_file = directory + "/skin_window_benchmark_extruder.def.json";
+    {
+        std::ofstream machine(machine_file);
+        machine << "{\"metadata\": {\"machine_extruder_trains\": {\"0\": \"skin_window_benchmark_extruder\"}}, \"settings\": {";
+        for (const auto& setting : settings)
+        {
+            machine << (&setting == &settings[0] ? "" : ", ") << "\"" << setting[0] << "\": {\"label\": \"" << setting[0] << "\", \"default_value\": \"" << setting[1] << "\"}";
+        }
+        machine << "}}";
+    }
+    std::ofstream(extruder_file) << "{\"settings\": {}}";
+    const bool is_created = SettingRegistry::getInstance()->loadJSONsettings(machine_file, &machine_settings) == 0 && meshgroup.createExtruderTrain(0);
+    std::remove(machine_file.c_str());
+    std::remove(extruder_file.c_str());
+    return is_created;
+}
+
+int main(int argc, char** argv)
+{
+    const int repetitions = (argc > 1) ? std::max(1, atoi(argv[1])) : 3;
+
+    SettingsBase machine_settings;
+    MeshGroup meshgroup(&machine_settings);
+    meshgroup.meshes.emplace_back(&meshgroup);
+    if (!createExtruderTrain(meshgroup, machine_settings))
+    {
+        printf("Couldn't create the extruder train.\n");
+        return 1;
+    }
+    SliceDataStorage storage(&meshgroup);
+
+    bool is_all_equal = true;
+    for (const bool has_several_parts : {false, true})
+    {
+        double time_per_layer = 0;
+        double time_sliding_window = 0;
+        for (int repetition = 0; repetition < repetitions; repetition++)
+        {
+            SliceMeshStorage per_layer(&storage, &meshgroup.meshes[0], 0);
+            generateLayers(per_layer, has_several_parts);
+            time_per_layer += computeSkins(storage, per_layer, false);
+
+            SliceMeshStorage sliding_window(&storage, &meshgroup.meshes[0], 0);
+            generateLayers(sliding_window, has_several_parts);
+            time_sliding_window += computeSkins(storage, sliding_window, true);
+
+            for (unsigned int layer_nr = 0; layer_nr < layer_count; layer_nr++)
+            {
+                if (!isEqual(per_layer.layers[layer_nr], sliding_window.layers[layer_nr]))
+                {
+                    printf("Layer %u differs.\n", layer_nr);
+                    is_all_equal = false;
+                }
+            }
+        }
+        printf("%-13s %u layers  per_layer %8.3fs  sliding_window %8.3fs  speedup %5.2fx\n", has_several_parts ? "several parts" : "one part", layer_count,
+            time_per_layer / repetitions, time_sliding_window / repetitions, time_per_layer / time_sliding_window);
+    }
+    printf("%s\n", is_all_equal ? "identical" : "DIFFERENT");
+    return is_all_equal ? 0 : 1;
+}
@@ -484,6 +484,8 @@ void CommandSocket::handleObjectList(cura::proto::ObjectList* list, const google
         meshgroup->meshes.push_back(extruder_train); //Construct a new mesh (with the corresponding extruder train as settings parent object) and put it into MeshGroup's mesh list.
         Mesh& mesh = meshgroup->meshes.back();
 
+        std::vector<Point3> face_vertices; // every three consecutive vertices form a face
+        face_vertices.reserve(face_count * 3);
         for (int i = 0; i < face_count; ++i)
         {
             //TODO: Apply matrix
@@ -494,7 +496,9 @@ void CommandSocket::handleObjectList(cura::proto::ObjectList* list, const google
             verts[0] = matrix.apply(float_vertices[0]);
             verts[1] = matrix.apply(float_vertices[1]);
             verts[2] = matrix.apply(float_vertices[2]);
-            mesh.addFace(verts[0], verts[1], verts[2]);
+            face_vertices.push_back(verts[0]);
+            face_vertices.push_back(verts[1]);
+            face_vertices.push_back(verts[2]);
 
             DEBUG_OUTPUT_OBJECT_STL_THROUGH_CERR("  facet normal -1 0 0\n");
             DEBUG_OUTPUT_OBJECT_STL_THROUGH_CERR("    outer loop\n");
@@ -505,6 +509,7 @@ void CommandSocket::handleObjectList(cura::proto::ObjectList* list, const google
             DEBUG_OUTPUT_OBJECT_STL_THROUGH_CERR("  endfacet\n");
         }
         DEBUG_OUTPUT_OBJECT_STL_THROUGH_CERR("endsolid Cura_out\n");
+        mesh.addFaces(std::move(face_vertices)); // meld the vertices per location rather than in the order of the faces, like when loading a file
 
         for (auto setting : object.settings())
         {
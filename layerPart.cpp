@@ -20,7 +20,13 @@ It's also the first step that stores the result in the "data storage" so all oth
 
 namespace cura {
 
-void createLayerWithParts(SliceLayer& storageLayer, SlicerLayer* layer, bool union_layers, bool union_all_remove_holes)
+/*!
+ * Split a slice into parts, reusing the Clipper objects of earlier layers.
+ *
+ * \param clipper The clipper to use for splitting the slice
+ * \param poly_tree The poly tree to use for splitting the slice
+ */
+static void createLayerWithParts(SliceLayer& storageLayer, SlicerLayer* layer, bool union_layers, bool union_all_remove_holes, ClipperLib::Clipper& clipper, ClipperLib::PolyTree& poly_tree)
 {
     storageLayer.openPolyLines = layer->openPolylines;
 
@@ -34,24 +40,40 @@ void createLayerWithParts(SliceLayer& storageLayer, SlicerLayer* layer, bool uni
     }
     
     std::vector<PolygonsPart> result;
-    result = layer->polygons.splitIntoParts(union_layers || union_all_remove_holes);
+    result = layer->polygons.splitIntoParts(union_layers || union_all_remove_holes, clipper, poly_tree);
     for(unsigned int i=0; i<result.size(); i++)
     {
         storageLayer.parts.emplace_back();
         storageLayer.parts[i].outline = result[i];
         storageLayer.parts[i].boundaryBox.calculate(storageLayer.parts[i].outline);
     }
+    storageLayer.calculateBoundaryBox();
+}
+
+void createLayerWithParts(SliceLayer& storageLayer, SlicerLayer* layer, bool union_layers, bool union_all_remove_holes)
+{
+    ClipperLib::Clipper clipper;
+    ClipperLib::PolyTree poly_tree;
+    createLayerWithParts(storageLayer, layer, union_layers, union_all_remove_holes, clipper, poly_tree);
 }
+
 void createLayerParts(SliceMeshStorage& mesh, Slicer* slicer, bool union_layers, bool union_all_remove_holes)
 {
     const auto total_layers = slicer->layers.size();
     assert(mesh.layers.size() == total_layers);
-#pragma omp parallel for default(none) shared(mesh,slicer) firstprivate(union_layers,union_all_remove_holes) schedule(dynamic)
-    for (unsigned int layer_nr = 0; layer_nr < total_layers; layer_nr++)
+#pragma omp parallel default(none) shared(mesh,slicer) firstprivate(total_layers,union_layers,union_all_remove_holes)
     {
-        SliceLayer& layer_storage = mesh.layers[layer_nr];
-        SlicerLayer& slice_layer = slicer->layers[layer_nr];
-        createLayerWithParts(layer_storage, &slice_layer, union_layers, union_all_remove_holes);
+        // reused for all layers of this thread, rather than constructed and destroyed for each layer
+        ClipperLib::Clipper clipper;
+        ClipperLib::PolyTree poly_tree;
+
+#pragma omp for schedule(dynamic)
+        for (unsigned int layer_nr = 0; layer_nr < total_layers; layer_nr++)
+        {
+            SliceLayer& layer_storage = mesh.layers[layer_nr];
+            SlicerLayer& slice_layer = slicer->layers[layer_nr];
+            createLayerWithParts(layer_storage, &slice_layer, union_layers, union_all_remove_holes, clipper, poly_tree);
+        }
     }
 
     for (unsigned int layer_nr = total_layers - 1; static_cast<int>(layer_nr) != -1; layer_nr--)
@@ -40,15 +40,16 @@ void print_usage()
     logAlways("CuraEngine help\n");
     logAlways("\tShow this help message\n");
     logAlways("\n");
-    logAlways("CuraEngine connect <host>[:<port>] [-j <settings.def.json>]\n");
+    logAlways("CuraEngine connect <host>[:<port>] [-j <settings.def.json>] [-c <cache_directory>]\n");
     logAlways("  --connect <host>[:<port>]\n\tConnect to <host> via a command socket, \n\tinstead of passing information via the command line\n");
     logAlways("  -j<settings.def.json>\n\tLoad settings.json file to register all settings and their defaults\n");
+    logAlways("  -c <cache_directory>\n\tCache the slices and walls of each mesh group in the given directory, \n\tso that they are only generated again when the settings they depend on change.\n");
     logAlways("  -v\n\tIncrease the verbose level (show log messages).\n");
 #ifdef _OPENMP
     logAlways("  -m<thread_count>\n\tSet the desired number of threads. Supports only a single digit.\n");
 #endif // _OPENMP
     logAlways("\n");
-    logAlways("CuraEngine slice [-v] [-p] [-j <settings.json>] [-s <settingkey>=<value>] [-g] [-e<extruder_nr>] [-o <output.gcode>] [-l <model.stl>] [--next]\n");
+    logAlways("CuraEngine slice [-v] [-p] [-j <settings.json>] [-s <settingkey>=<value>] [-g] [-e<extruder_nr>] [-o <output.gcode>] [-c <cache_directory>] [-d <snapshot_file>] [-l <model.stl>] [--next]\n");
     logAlways("  -v\n\tIncrease the verbose level (show log messages).\n");
 #ifdef _OPENMP
     logAlways("  -m<thread_count>\n\tSet the desired number of threads.\n");
@@ -61,6 +62,8 @@ void print_usage()
     logAlways("  -e<extruder_nr>\n\tSwitch setting focus to the extruder train with the given number.\n");
     logAlways("  --next\n\tGenerate gcode for the previously supplied mesh group and append that to \n\tthe gcode of further models for one-at-a-time printing.\n");
     logAlways("  -o <output_file>\n\tSpecify a file to which to write the generated gcode.\n");
+    logAlways("  -d <snapshot_file>\n\tAlso write the planned paths of each layer to a binary snapshot file, \n\tto compare them between versions of the engine.\n");
+    logAlways("  -c <cache_directory>\n\tCache the slices and walls of each mesh group in the given directory, \n\tso that they are only generated again when the settings they depend on change.\n");
     logAlways("\n");
     logAlways("The settings are appended to the last supplied object:\n");
     logAlways("CuraEngine slice [general settings] \n\t-g [current group settings] \n\t-e0 [extruder train 0 settings] \n\t-l obj_inheriting_from_last_extruder_train.stl [object settings] \n\t--next [next group settings]\n\t... etc.\n");
@@ -131,6 +134,10 @@ void connect(int argc, char **argv)
                         std::exit(1);
                     }
                     break;
+                case 'c':
+                    argn++;
+                    FffProcessor::getInstance()->setSliceCacheDirectory(argv[argn]);
+                    break;
                 default:
                     cura::logError("Unknown option: %c\n", *str);
                     print_call(argc, argv);
@@ -256,6 +263,18 @@ void slice(int argc, char **argv)
                             last_settings_object = &(meshgroup->meshes.back()); // pointer is valid until a new object is added, so this is OK
                         }
                         break;
+                    case 'c':
+                        argn++;
+                        FffProcessor::getInstance()->setSliceCacheDirectory(argv[argn]);
+                        break;
+                    case 'd':
+                        argn++;
+                        if (!FffProcessor::getInstance()->setLayerPlanSnapshotFile(argv[argn]))
+                        {
+                            cura::logError("Failed to open %s for output.\n", argv[argn]);
+                            exit(1);
+                        }
+                        break;
                     case 'o':
                         argn++;
                         if (!FffProcessor::getInstance()->setTargetFile(argv[argn]))
@@ -1,6 +1,14 @@
 //Copyright (c) 2017 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> // sort
+#include <limits> // numeric_limits
+#include <tuple> // make_tuple
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif // _OPENMP
+
 #include "mesh.h"
 #include "utils/logoutput.h"
 #include "utils/math.h"
@@ -9,13 +17,58 @@ namespace cura
 {
 
 const int vertex_meld_distance = MM2INT(0.03);
+//! The size of the cells of the grid in which vertices are looked up: any location within vertex_meld_distance of a point lies in a cell adjacent to the cell of that point.
+const coord_t vertex_grid_cell_size = 2 * vertex_meld_distance;
+//! The number of bits of each cell coordinate stored in a cell key. Cells which are 2^21 cells (126 m) apart share the same key, which only costs a few distance checks.
+const int vertex_grid_key_bits = 21;
+
+/*!
+ * Get the coordinate of the grid cell in which a coordinate lies, rounding downward.
+ */
+static inline coord_t gridCellCoord(const coord_t coord)
+{
+    return (coord >= 0) ? coord / vertex_grid_cell_size : -((-coord - 1) / vertex_grid_cell_size) - 1;
+}
+
 /*!
- * returns a hash for the location, but first divides by the vertex_meld_distance,
- * so that any point within a box of vertex_meld_distance by vertex_meld_distance would get mapped to the same hash.
+ * Get the 64-bit key of the grid cell with the given cell coordinates.
  */
-static inline uint32_t pointHash(const Point3& p)
+static inline uint64_t gridCellKey(const coord_t cell_x, const coord_t cell_y, const coord_t cell_z)
 {
-    return ((p.x + vertex_meld_distance/2) / vertex_meld_distance) ^ (((p.y + vertex_meld_distance/2) / vertex_meld_distance) << 10) ^ (((p.z + vertex_meld_distance/2) / vertex_meld_distance) << 20);
+    constexpr uint64_t mask = (uint64_t(1) << vertex_grid_key_bits) - 1;
+    return ((cell_x & mask) << (2 * vertex_grid_key_bits)) | ((cell_y & mask) << vertex_grid_key_bits) | (cell_z & mask);
+}
+
+/*!
+ * Get the key of the grid cell in which a location lies.
+ */
+static inline uint64_t pointCellKey(const Point3& p)
+{
+    return gridCellKey(gridCellCoord(p.x), gridCellCoord(p.y), gridCellCoord(p.z));
+}
+
+/*!
+ * Get the keys of the seven neighboring grid cells which can contain locations within vertex_meld_distance of \p p.
+ *
+ * Along each axis the point is closer than vertex_meld_distance to only one of the two neighboring cells,
+ * so only the neighbors on the near side along each axis need to be considered.
+ *
+ * \param p The location
+ * \param[out] keys The keys of the neighboring cells
+ */
+static inline void nearNeighborCellKeys(const Point3& p, uint64_t keys[7])
+{
+    const coord_t cell_x = gridCellCoord(p.x);
+    const coord_t cell_y = gridCellCoord(p.y);
+    const coord_t cell_z = gridCellCoord(p.z);
+    const coord_t step_x = (p.x - cell_x * vertex_grid_cell_size < vertex_meld_distance) ? -1 : 1;
+    const coord_t step_y = (p.y - cell_y * vertex_grid_cell_size < vertex_meld_distance) ? -1 : 1;
+    const coord_t step_z = (p.z - cell_z * vertex_grid_cell_size < vertex_meld_distance) ? -1 : 1;
+    int key_idx = 0;
+    for (int neighbor = 1; neighbor < 8; neighbor++)
+    {
+        keys[key_idx++] = gridCellKey(cell_x + ((neighbor & 1) ? step_x : 0), cell_y + ((neighbor & 2) ? step_y : 0), cell_z + ((neighbor & 4) ? step_z : 0));
+    }
 }
 
 Mesh::Mesh(SettingsBaseVirtual* parent)
@@ -38,9 +91,204 @@ void Mesh::addFace(Point3& v0, Point3& v1, Point3& v2)
     face.vertex_index[0] = vi0;
     face.vertex_index[1] = vi1;
     face.vertex_index[2] = vi2;
-    vertices[face.vertex_index[0]].connected_faces.push_back(idx);
-    vertices[face.vertex_index[1]].connected_faces.push_back(idx);
-    vertices[face.vertex_index[2]].connected_faces.push_back(idx);
+}
+
+void Mesh::addFaces(std::vector<Point3> face_vertices)
+{
+    if (!vertices.empty())
+    { // the new vertices might have to be melded with existing ones, which are only known to the vertex_hash_map
+        for (size_t vertex_idx = 0; vertex_idx + 2 < face_vertices.size(); vertex_idx += 3)
+        {
+            Point3 v0 = face_vertices[vertex_idx];
+            Point3 v1 = face_vertices[vertex_idx + 1];
+            Point3 v2 = face_vertices[vertex_idx + 2];
+            addFace(v0, v1, v2);
+        }
+        return;
+    }
+
+    const int point_count = face_vertices.size() - face_vertices.size() % 3;
+
+    // Group the points per grid cell in parallel.
+    // The points are first distributed over a fixed number of partitions by their cell key, so that every cell lies within one partition.
+    // Each partition is then sorted by cell key and each cell by location, so that the order in which points are melded only depends on their locations.
+    // The number of partitions doesn't depend on the number of threads, so that neither does the result.
+    constexpr int partition_count = 64;
+    std::vector<uint64_t> keys(point_count); // the cell key of each point
+#pragma omp parallel for default(none) shared(face_vertices, keys) firstprivate(point_count)
+    for (int point_idx = 0; point_idx < point_count; point_idx++)
+    {
+        keys[point_idx] = pointCellKey(face_vertices[point_idx]);
+    }
+    std::vector<int> partition_start(partition_count + 1, 0);
+    for (int point_idx = 0; point_idx < point_count; point_idx++)
+    {
+        partition_start[keys[point_idx] % partition_count + 1]++;
+    }
+    for (int partition_idx = 0; partition_idx < partition_count; partition_idx++)
+    {
+        partition_start[partition_idx + 1] += partition_start[partition_idx];
+    }
+    std::vector<uint32_t> order(point_count); // the indices of the points in melding order
+    {
+        std::vector<int> partition_end(partition_start.begin(), partition_start.end() - 1);
+        for (int point_idx = 0; point_idx < point_count; point_idx++)
+        {
+            order[partition_end[keys[point_idx] % partition_count]++] = point_idx;
+        }
+    }
+
+#pragma omp parallel for default(none) shared(face_vertices, keys, partition_start, order) schedule(dynamic)
+    for (int partition_idx = 0; partition_idx < partition_count; partition_idx++)
+    {
+        std::sort(order.begin() + partition_start[partition_idx], order.begin() + partition_start[partition_idx + 1], [&face_vertices, &keys](const uint32_t a, const uint32_t b)
+            {
+                const Point3& p_a = face_vertices[a];
+                const Point3& p_b = face_vertices[b];
+                return std::make_tuple(keys[a], p_a.x, p_a.y, p_a.z, a) < std::make_tuple(keys[b], p_b.x, p_b.y, p_b.z, b);
+            });
+    }
+
+    // Index the cells by key in an open addressing hash table, so that the neighboring cells of a point can be found quickly.
+    // A cell is identified by the position of its first point in order.
+    constexpr uint32_t NO_CELL = std::numeric_limits<uint32_t>::max();
+    size_t cell_count = 0;
+    for (int position = 0; position < point_count; position++)
+    {
+        cell_count += position == 0 || keys[order[position]] != keys[order[position - 1]];
+    }
+    int cell_table_bits = 4;
+    while ((size_t(1) << cell_table_bits) < 2 * cell_count)
+    {
+        cell_table_bits++;
+    }
+    const uint64_t cell_table_mask = (uint64_t(1) << cell_table_bits) - 1;
+    std::vector<uint32_t> cell_table(cell_table_mask + 1, NO_CELL);
+    auto cellTableSlot = [cell_table_bits](const uint64_t key)
+    {
+        return (key * 0x9E3779B97F4A7C15ull) >> (64 - cell_table_bits);
+    };
+    for (int position = 0; position < point_count; position++)
+    {
+        if (position == 0 || keys[order[position]] != keys[order[position - 1]])
+        {
+            uint64_t slot = cellTableSlot(keys[order[position]]);
+            while (cell_table[slot] != NO_CELL)
+            {
+                slot = (slot + 1) & cell_table_mask;
+            }
+            cell_table[slot] = position;
+        }
+    }
+    auto findCell = [&](const uint64_t key)
+    {
+        for (uint64_t slot = cellTableSlot(key); cell_table[slot] != NO_CELL; slot = (slot + 1) & cell_table_mask)
+        {
+            if (keys[order[cell_table[slot]]] == key)
+            {
+                return cell_table[slot];
+            }
+        }
+        return NO_CELL;
+    };
+
+    // Meld the points in the sorted order, using the same rules as findIndexOfVertex.
+    // This has to be sequential, since whether a point becomes a vertex depends on which earlier points became vertices.
+    // The points which became a vertex are kept per cell in a linked list, most recent first.
+    constexpr uint32_t NO_POINT = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> cell_first_vertex(point_count, NO_POINT);
+    std::vector<uint32_t> next_vertex_in_cell(point_count);
+    auto findEarliestMeldedPosition = [&](const uint32_t cell, const Point3& p)
+    {
+        uint32_t result = NO_POINT;
+        for (uint32_t vertex_position = cell_first_vertex[cell]; vertex_position != NO_POINT; vertex_position = next_vertex_in_cell[vertex_position])
+        {
+            if ((face_vertices[order[vertex_position]] - p).testLength(vertex_meld_distance))
+            {
+                result = vertex_position;
+            }
+        }
+        return result;
+    };
+    std::vector<uint32_t> representative(point_count); // for each point, the index of the point which becomes the vertex it is melded with
+    uint32_t cell = 0;
+    for (int position = 0; position < point_count; position++)
+    {
+        if (keys[order[position]] != keys[order[cell]])
+        {
+            cell = position;
+        }
+        const Point3& p = face_vertices[order[position]];
+        uint32_t melded_position = findEarliestMeldedPosition(cell, p);
+        if (melded_position == NO_POINT)
+        {
+            uint64_t neighbor_keys[7];
+            nearNeighborCellKeys(p, neighbor_keys);
+            for (const uint64_t neighbor_key : neighbor_keys)
+            {
+                const uint32_t neighbor_cell = findCell(neighbor_key);
+                if (neighbor_cell != NO_CELL && neighbor_cell != cell)
+                {
+                    melded_position = std::min(melded_position, findEarliestMeldedPosition(neighbor_cell, p));
+                }
+            }
+        }
+        if (melded_position == NO_POINT)
+        {
+            melded_position = position;
+            next_vertex_in_cell[position] = cell_first_vertex[cell];
+            cell_first_vertex[cell] = position;
+        }
+        representative[order[position]] = order[melded_position];
+    }
+    keys.clear();
+    keys.shrink_to_fit();
+    order.clear();
+    order.shrink_to_fit();
+    cell_table.clear();
+    cell_table.shrink_to_fit();
+    cell_first_vertex.clear();
+    cell_first_vertex.shrink_to_fit();
+
+    // Create the vertices in order of first occurrence, at the location of their representative.
+    int vertex_count = 0;
+    for (int point_idx = 0; point_idx < point_count; point_idx++)
+    {
+        vertex_count += representative[point_idx] == static_cast<uint32_t>(point_idx);
+    }
+    vertices.reserve(vertices.size() + vertex_count);
+    std::vector<uint32_t>& vertex_indices = next_vertex_in_cell; // reuse the memory
+    std::fill(vertex_indices.begin(), vertex_indices.end(), NO_POINT);
+    for (int point_idx = 0; point_idx < point_count; point_idx++)
+    {
+        const uint32_t representative_idx = representative[point_idx];
+        if (vertex_indices[representative_idx] == NO_POINT)
+        {
+            vertex_indices[representative_idx] = vertices.size();
+            vertices.emplace_back(face_vertices[representative_idx]);
+            aabb.include(face_vertices[representative_idx]);
+        }
+        vertex_indices[point_idx] = vertex_indices[representative_idx];
+    }
+    representative.clear();
+    representative.shrink_to_fit();
+    face_vertices.clear();
+    face_vertices.shrink_to_fit();
+
+    faces.reserve(faces.size() + point_count / 3);
+    for (int point_idx = 0; point_idx < point_count; point_idx += 3)
+    {
+        const int vi0 = vertex_indices[point_idx];
+        const int vi1 = vertex_indices[point_idx + 1];
+        const int vi2 = vertex_indices[point_idx + 2];
+        if (vi0 == vi1 || vi1 == vi2 || vi0 == vi2) continue; // the face has two vertices which get assigned the same location. Don't add the face.
+
+        faces.emplace_back();
+        MeshFace& face = faces.back();
+        face.vertex_index[0] = vi0;
+        face.vertex_index[1] = vi1;
+        face.vertex_index[2] = vi2;
+    }
 }
 
 void Mesh::clear()
@@ -48,6 +296,8 @@ void Mesh::clear()
     faces.clear();
     vertices.clear();
     vertex_hash_map.clear();
+    vertex_faces_start.clear();
+    vertex_faces.clear();
 }
 
 void Mesh::finish()
@@ -55,14 +305,79 @@ void Mesh::finish()
     // Finish up the mesh, clear the vertex_hash_map, as it's no longer needed from this point on and uses quite a bit of memory.
     vertex_hash_map.clear();
 
+    // Release the spare capacity left by adding vertices one by one.
+    vertices.shrink_to_fit();
+    faces.shrink_to_fit();
+
+    buildVertexFaces();
+
     // For each face, store which other face is connected with it.
-    for(unsigned int i=0; i<faces.size(); i++)
+    // The edges of the faces around each vertex are grouped by their other end, so that all faces on an edge are found at once.
+    // Each edge of a face is handled by the vertex at which it starts, so the vertices can be processed in parallel.
+    const int vertex_count = vertices.size();
+#pragma omp parallel default(none) firstprivate(vertex_count)
+    {
+        std::vector<std::pair<int, int>> star_edges; // for each face around the vertex, the vertices at the other end of its two edges with the vertex, with that face
+        std::vector<int> candidate_faces;
+#pragma omp for schedule(dynamic, 1024)
+        for (int vertex_idx = 0; vertex_idx < vertex_count; vertex_idx++)
+        {
+            star_edges.clear();
+            for (const uint32_t face_idx : getConnectedFaces(vertex_idx))
+            {
+                for (const int other_vertex_idx : faces[face_idx].vertex_index)
+                {
+                    if (other_vertex_idx != vertex_idx)
+                    {
+                        star_edges.emplace_back(other_vertex_idx, face_idx);
+                    }
+                }
+            }
+            std::sort(star_edges.begin(), star_edges.end());
+
+            for (const uint32_t face_idx : getConnectedFaces(vertex_idx))
+            {
+                MeshFace& face = faces[face_idx];
+                const int edge_idx = (face.vertex_index[0] == vertex_idx) ? 0 : ((face.vertex_index[1] == vertex_idx) ? 1 : 2);
+                const int next_vertex_idx = face.vertex_index[(edge_idx + 1) % 3];
+                candidate_faces.clear();
+                for (std::vector<std::pair<int, int>>::const_iterator it = std::lower_bound(star_edges.cbegin(), star_edges.cend(), std::make_pair(next_vertex_idx, -1)); it != star_edges.cend() && it->first == next_vertex_idx; ++it)
+                {
+                    if (it->second != static_cast<int>(face_idx))
+                    {
+                        candidate_faces.push_back(it->second);
+                    }
+                }
+                // faces are connected via the outside
+                face.connected_face_index[edge_idx] = getFaceIdxWithPoints(vertex_idx, next_vertex_idx, face_idx, face.vertex_index[(edge_idx + 2) % 3], candidate_faces);
+            }
+        }
+    }
+}
+
+void Mesh::buildVertexFaces()
+{
+    // Count the faces per vertex, then place the face indices with a counting sort so that they stay in increasing order per vertex.
+    vertex_faces_start.assign(vertices.size() + 1, 0);
+    for (const MeshFace& face : faces)
+    {
+        for (const int vertex_idx : face.vertex_index)
+        {
+            vertex_faces_start[vertex_idx + 1]++;
+        }
+    }
+    for (size_t vertex_idx = 0; vertex_idx < vertices.size(); vertex_idx++)
+    {
+        vertex_faces_start[vertex_idx + 1] += vertex_faces_start[vertex_idx];
+    }
+    vertex_faces.resize(vertex_faces_start.back());
+    std::vector<uint32_t> vertex_faces_end(vertex_faces_start.begin(), vertex_faces_start.end() - 1);
+    for (uint32_t face_idx = 0; face_idx < faces.size(); face_idx++)
     {
-        MeshFace& face = faces[i];
-        // faces are connected via the outside
-        face.connected_face_index[0] = getFaceIdxWithPoints(face.vertex_index[0], face.vertex_index[1], i, face.vertex_index[2]);
-        face.connected_face_index[1] = getFaceIdxWithPoints(face.vertex_index[1], face.vertex_index[2], i, face.vertex_index[0]);
-        face.connected_face_index[2] = getFaceIdxWithPoints(face.vertex_index[2], face.vertex_index[0], i, face.vertex_index[1]);
+        for (const int vertex_idx : faces[face_idx].vertex_index)
+        {
+            vertex_faces[vertex_faces_end[vertex_idx]++] = face_idx;
+        }
     }
 }
 
@@ -85,20 +400,53 @@ void Mesh::expandXY(int64_t offset)
         aabb.expandXY(offset);
     }
 }
+void Mesh::setAABB(const AABB3D& aabb)
+{
+    this->aabb = aabb;
+}
 
 
 int Mesh::findIndexOfVertex(const Point3& v)
 {
-    uint32_t hash = pointHash(v);
+    // Duplicate locations end up in the same cell, so look there first.
+    std::vector<uint32_t>& cell_vertices = vertex_hash_map[pointCellKey(v)];
+    for (const uint32_t vertex_idx : cell_vertices)
+    {
+        if ((Point3(vertices[vertex_idx].p) - v).testLength(vertex_meld_distance))
+        {
+            return vertex_idx;
+        }
+    }
 
-    for(unsigned int idx = 0; idx < vertex_hash_map[hash].size(); idx++)
+    // Close locations can still lie on different sides of a cell border.
+    int best_idx = -1;
+    uint64_t neighbor_keys[7];
+    nearNeighborCellKeys(v, neighbor_keys);
+    for (const uint64_t neighbor_key : neighbor_keys)
     {
-        if ((vertices[vertex_hash_map[hash][idx]].p - v).testLength(vertex_meld_distance))
+        const std::unordered_map<uint64_t, std::vector<uint32_t>>::const_iterator neighbor = vertex_hash_map.find(neighbor_key);
+        if (neighbor == vertex_hash_map.end() || &neighbor->second == &cell_vertices)
+        {
+            continue;
+        }
+        for (const uint32_t vertex_idx : neighbor->second)
         {
-            return vertex_hash_map[hash][idx];
+            if ((Point3(vertices[vertex_idx].p) - v).testLength(vertex_meld_distance))
+            {
+                if (best_idx < 0 || static_cast<int>(vertex_idx) < best_idx)
+                {
+                    best_idx = vertex_idx;
+                }
+                break;
+            }
         }
     }
-    vertex_hash_map[hash].push_back(vertices.size());
+    if (best_idx >= 0)
+    {
+        return best_idx;
+    }
+
+    cell_vertices.push_back(vertices.size());
     vertices.emplace_back(v);
 
     aabb.include(v);
@@ -130,30 +478,12 @@ See <a href="http://stackoverflow.com/questions/14066933/direct-way-of-computing
 
 
 */
-int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVertexIdx) const
+int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVertexIdx, const std::vector<int>& candidateFaces) const
 {
-    std::vector<int> candidateFaces; // in case more than two faces meet at an edge, multiple candidates are generated
-    for(int f : vertices[idx0].connected_faces) // search through all faces connected to the first vertex and find those that are also connected to the second
-    {
-        if (f == notFaceIdx)
-        {
-            continue;
-        }
-        if ( faces[f].vertex_index[0] == idx1 // && faces[f].vertex_index[1] == idx0 // next face should have the right direction!
-          || faces[f].vertex_index[1] == idx1 // && faces[f].vertex_index[2] == idx0
-          || faces[f].vertex_index[2] == idx1 // && faces[f].vertex_index[0] == idx0
-            )  candidateFaces.push_back(f);
-
-    }
-
     if (candidateFaces.size() == 0)
     {
         cura::logDebug("Couldn't find face connected to face %i.\n", notFaceIdx);
-        if (!has_disconnected_faces)
-        {
-            cura::logWarning("Mesh has disconnected faces!\n");
-        }
-        has_disconnected_faces = true;
+        registerDisconnectedFaces();
         return -1;
     }
     if (candidateFaces.size() == 1) { return candidateFaces[0]; }
@@ -162,19 +492,17 @@ int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVe
     if (candidateFaces.size() % 2 == 0)
     {
         cura::logDebug("Warning! Edge with uneven number of faces connecting it!(%i)\n", candidateFaces.size()+1);
-        if (!has_disconnected_faces)
-        {
-            cura::logWarning("Mesh has disconnected faces!\n");
-        }
-        has_disconnected_faces = true;
+        registerDisconnectedFaces();
     }
 
-    FPoint3 vn = vertices[idx1].p - vertices[idx0].p;
+    const Point3 p0 = vertices[idx0].p;
+    const Point3 p1 = vertices[idx1].p;
+    FPoint3 vn = p1 - p0;
     FPoint3 n = vn / vn.vSize(); // the normal of the plane in which all normals of faces connected to the edge lie => the normalized normal
-    FPoint3 v0 = vertices[idx1].p - vertices[idx0].p;
+    FPoint3 v0 = p1 - p0;
 
 // the normals below are abnormally directed! : these normals all point counterclockwise (viewed from idx1 to idx0) from the face, irrespective of the direction of the face.
-    FPoint3 n0 = FPoint3(vertices[notFaceVertexIdx].p - vertices[idx0].p).cross(v0);
+    FPoint3 n0 = FPoint3(Point3(vertices[notFaceVertexIdx].p) - p0).cross(v0);
 
     if (n0.vSize() <= 0)
     {
@@ -193,7 +521,7 @@ int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVe
                     break;
         }
 
-        FPoint3 v1 = vertices[faces[candidateFace].vertex_index[candidateVertex]].p - vertices[idx0].p;
+        FPoint3 v1 = Point3(vertices[faces[candidateFace].vertex_index[candidateVertex]].p) - p0;
         FPoint3 n1 = v0.cross(v1);
 
         double dot = n0 * n1;
@@ -204,11 +532,7 @@ int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVe
         if (angle == 0)
         {
             cura::logDebug("Overlapping faces: face %i and face %i.\n", notFaceIdx, candidateFace);
-            if (!has_overlapping_faces)
-            {
-                cura::logWarning("Mesh has overlapping faces!\n");
-            }
-            has_overlapping_faces = true;
+            registerOverlappingFaces();
         }
         if (angle < smallestAngle)
         {
@@ -219,13 +543,33 @@ int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVe
     if (bestIdx < 0)
     {
         cura::logDebug("Couldn't find face connected to face %i.\n", notFaceIdx);
+        registerDisconnectedFaces();
+    }
+    return bestIdx;
+}
+
+void Mesh::registerDisconnectedFaces() const
+{
+#pragma omp critical (mesh_warnings)
+    {
         if (!has_disconnected_faces)
         {
             cura::logWarning("Mesh has disconnected faces!\n");
         }
         has_disconnected_faces = true;
     }
-    return bestIdx;
+}
+
+void Mesh::registerOverlappingFaces() const
+{
+#pragma omp critical (mesh_warnings)
+    {
+        if (!has_overlapping_faces)
+        {
+            cura::logWarning("Mesh has overlapping faces!\n");
+        }
+        has_overlapping_faces = true;
+    }
 }
 
 }//namespace cura
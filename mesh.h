@@ -1,23 +1,77 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include <cassert>
+
 #include "settings/settings.h"
 #include "utils/AABB3D.h"
 
 namespace cura
 {
+
+#ifdef MESH_32BIT_COORDINATES
+/*!
+ * A location of a vertex stored with 32-bit coordinates, which is half the size of a Point3.
+ *
+ * In microns this covers more than two kilometers around the origin, which is plenty for any printer.
+ * It converts to and from Point3, so the location can be read as a Point3 wherever it is used.
+ */
+class MeshPoint3
+{
+public:
+    int32_t x, y, z;
+
+    MeshPoint3(const Point3& p)
+    : x(p.x), y(p.y), z(p.z)
+    {
+        assert(Point3(x, y, z) == p && "Mesh coordinates should fit in 32 bits!");
+    }
+
+    operator Point3() const
+    {
+        return Point3(x, y, z);
+    }
+
+    MeshPoint3& operator +=(const Point3& offset)
+    {
+        *this = MeshPoint3(Point3(*this) + offset);
+        return *this;
+    }
+};
+using MeshPoint = MeshPoint3;
+#else
+using MeshPoint = Point3;
+#endif // MESH_32BIT_COORDINATES
+
 /*!
 Vertex type to be used in a Mesh.
 
-Keeps track of which faces connect to it.
+The faces connected to a vertex are kept by the Mesh; see Mesh::getConnectedFaces.
+Define MESH_32BIT_COORDINATES to store the locations of vertices in half the memory.
 */
 class MeshVertex
 {
 public:
-    Point3 p; //!< location of the vertex
-    std::vector<uint32_t> connected_faces; //!< list of the indices of connected faces
+    MeshPoint p; //!< location of the vertex
 
-    MeshVertex(Point3 p) : p(p) {connected_faces.reserve(8);} //!< doesn't set connected_faces
+    MeshVertex(Point3 p) : p(p) {}
+};
+
+/*!
+ * The indices of the faces connected to a single vertex, in order of increasing face index.
+ *
+ * This is a view on the adjacency data of a Mesh, so it is only valid as long as that mesh isn't changed.
+ */
+class MeshVertexFaces
+{
+public:
+    MeshVertexFaces(const uint32_t* begin, const uint32_t* end) : begin_(begin), end_(end) {}
+    const uint32_t* begin() const { return begin_; }
+    const uint32_t* end() const { return end_; }
+    size_t size() const { return end_ - begin_; }
+private:
+    const uint32_t* begin_;
+    const uint32_t* end_;
 };
 
 /*! A MeshFace is a 3 dimensional model triangle with 3 points. These points are already converted to integers
@@ -56,23 +110,68 @@ See MeshFace for the specifics of how/when faces are connected.
 */
 class Mesh : public SettingsBase // inherits settings
 {
-    //! The vertex_hash_map stores a index reference of each vertex for the hash of that location. Allows for quick retrieval of points with the same location.
-    std::unordered_map<uint32_t, std::vector<uint32_t> > vertex_hash_map;
+    //! The vertex_hash_map stores a index reference of each vertex for the 64-bit key of the grid cell of that location. Allows for quick retrieval of points with the same location.
+    std::unordered_map<uint64_t, std::vector<uint32_t> > vertex_hash_map;
     AABB3D aabb;
+    //! For each vertex, the position in \ref vertex_faces of its first connected face, followed by one end position. Filled in by \ref finish.
+    std::vector<uint32_t> vertex_faces_start;
+    std::vector<uint32_t> vertex_faces; //!< The indices of the faces connected to each vertex, one vertex after the other
+
 public:
     std::vector<MeshVertex> vertices;//!< list of all vertices in the mesh
     std::vector<MeshFace> faces; //!< list of all faces in the mesh
 
     Mesh(SettingsBaseVirtual* parent); //!< initializes the settings
 
-    void addFace(Point3& v0, Point3& v1, Point3& v2); //!< add a face to the mesh without settings it's connected_faces.
+    Mesh(Mesh&& other) = default; //!< Meshes are large, so they are only ever moved
+    Mesh& operator=(Mesh&& other) = default;
+    Mesh(const Mesh& other) = delete;
+    Mesh& operator=(const Mesh& other) = delete;
+
+    /*!
+     * Add a face to the mesh without setting its connected_face_index.
+     *
+     * Each corner is melded with the vertex with the lowest index within vertex_meld_distance of it,
+     * looking in the grid cell of the corner first and only then in the neighboring cells.
+     */
+    void addFace(Point3& v0, Point3& v1, Point3& v2);
+
+    /*!
+     * Add many faces to the mesh at once, without setting their connected_face_index.
+     *
+     * The corners are melded with the same rules as in \ref addFace, but they are grouped per grid cell in parallel
+     * and melded in an order which only depends on their locations, rather than in the order of the faces.
+     * Coinciding parts of the model, such as the top and bottom rings of a finely tessellated cylinder, are thus melded alike.
+     * The vertices are created in order of first occurrence, each at the location of the first of its corners in that melding order.
+     *
+     * If the mesh already has vertices, this falls back to calling \ref addFace for each face in turn.
+     * The added vertices are not registered in the vertex_hash_map, so only \ref finish should follow.
+     *
+     * \param face_vertices The corners of the faces. Each consecutive three points form one face.
+     * They are freed as soon as the vertices are created, so move them in if they aren't needed afterwards.
+     */
+    void addFaces(std::vector<Point3> face_vertices);
     void clear(); //!< clears all data
-    void finish(); //!< complete the model : set the connected_face_index fields of the faces.
+    void finish(); //!< complete the model : build the vertex to face adjacency and set the connected_face_index fields of the faces.
+
+    /*!
+     * Get the faces connected to a vertex.
+     *
+     * Only available after \ref finish has been called.
+     *
+     * \param vertex_idx The index of the vertex
+     * \return The indices of the faces connected to the vertex, in increasing order
+     */
+    MeshVertexFaces getConnectedFaces(const int vertex_idx) const
+    {
+        return MeshVertexFaces(vertex_faces.data() + vertex_faces_start[vertex_idx], vertex_faces.data() + vertex_faces_start[vertex_idx + 1]);
+    }
 
     Point3 min() const; //!< min (in x,y and z) vertex of the bounding box
     Point3 max() const; //!< max (in x,y and z) vertex of the bounding box
     AABB3D getAABB() const; //!< Get the axis aligned bounding box
     void expandXY(int64_t offset); //!< Register applied horizontal expansion in the AABB
+    void setAABB(const AABB3D& aabb); //!< Replace the axis aligned bounding box, e.g. by one which was stored with all expansion registered in it
     
     /*!
      * Offset the whole mesh (all vertices and the bounding box).
@@ -91,6 +190,21 @@ private:
     mutable bool has_overlapping_faces; //!< Whether it has been logged that this mesh contains overlapping faces
     int findIndexOfVertex(const Point3& v); //!< find index of vertex close to the given point, or create a new vertex and return its index.
 
+    /*!
+     * Fill \ref vertex_faces_start and \ref vertex_faces from the faces.
+     */
+    void buildVertexFaces();
+
+    /*!
+     * Log a warning that the mesh has disconnected faces, if that hasn't been done yet.
+     */
+    void registerDisconnectedFaces() const;
+
+    /*!
+     * Log a warning that the mesh has overlapping faces, if that hasn't been done yet.
+     */
+    void registerOverlappingFaces() const;
+
     /*!
      * Get the index of the face connected to the face with index \p notFaceIdx, via vertices \p idx0 and \p idx1.
      * 
@@ -100,9 +214,10 @@ private:
      * \param idx1 the second vertex index
      * \param notFaceIdx the index of a face which shouldn't be returned
      * \param notFaceVertexIdx should be the third vertex of face \p notFaceIdx.
+     * \param candidateFaces the indices of the other faces which contain both \p idx0 and \p idx1, in increasing order
      * \return the face index of a face sharing the edge from \p idx0 to \p idx1
     */
-    int getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVertexIdx) const;
+    int getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVertexIdx, const std::vector<int>& candidateFaces) const;
 };
 
 }//namespace cura
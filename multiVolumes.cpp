@@ -1,57 +1,113 @@
 //Copyright (c) 2017 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <cmath> // std::ceil
+
 #include "multiVolumes.h"
 
-namespace cura 
+#include "utils/AABB.h"
+
+namespace cura
+{
+
+/*!
+ * Get the number of layers of the volume with the most layers.
+ */
+static size_t getMaxLayerCount(const std::vector<Slicer*>& volumes)
+{
+    size_t layer_count = 0;
+    for (const Slicer* volume : volumes)
+    {
+        layer_count = std::max(layer_count, volume->layers.size());
+    }
+    return layer_count;
+}
+
+/*!
+ * Compute the 2D boundary box of the outlines of each volume in a single layer.
+ *
+ * Volumes which don't take part, or which don't have the layer, get an empty boundary box, which doesn't hit any other box.
+ * Since carving only ever removes area from a layer, the boxes stay valid (if not tight) while the layer is being carved.
+ *
+ * \param volumes The outline data of each mesh
+ * \param takes_part Whether to compute the boundary box of each volume
+ * \param layer_nr The layer for which to compute the boundary boxes
+ * \param[out] boxes The boundary box of each volume
+ */
+static void computeLayerBoundaryBoxes(const std::vector<Slicer*>& volumes, const std::vector<bool>& takes_part, const unsigned int layer_nr, std::vector<AABB>& boxes)
 {
- 
+    boxes.assign(volumes.size(), AABB());
+    for (unsigned int volume_idx = 0; volume_idx < volumes.size(); volume_idx++)
+    {
+        if (takes_part[volume_idx] && layer_nr < volumes[volume_idx]->layers.size())
+        {
+            boxes[volume_idx].calculate(volumes[volume_idx]->layers[layer_nr].polygons);
+        }
+    }
+}
+
 void carveMultipleVolumes(std::vector<Slicer*> &volumes, bool alternate_carve_order)
 {
+    std::vector<bool> is_carved(volumes.size());
+    for (unsigned int volume_idx = 0; volume_idx < volumes.size(); volume_idx++)
+    {
+        const Mesh& mesh = *volumes[volume_idx]->mesh;
+        is_carved[volume_idx] = !mesh.getSettingBoolean("infill_mesh")
+            && !mesh.getSettingBoolean("anti_overhang_mesh")
+            && !mesh.getSettingBoolean("support_mesh")
+            && mesh.getSettingAsSurfaceMode("magic_mesh_surface_mode") != ESurfaceMode::SURFACE;
+    }
+
     //Go trough all the volumes, and remove the previous volume outlines from our own outline, so we never have overlapped areas.
+    //The pairs are listed in the order in which they are carved, which is the same in every layer.
+    std::vector<std::pair<unsigned int, unsigned int>> carve_pairs;
     for (unsigned int volume_1_idx = 1; volume_1_idx < volumes.size(); volume_1_idx++)
     {
-        Slicer& volume_1 = *volumes[volume_1_idx];
-        if (volume_1.mesh->getSettingBoolean("infill_mesh") 
-            || volume_1.mesh->getSettingBoolean("anti_overhang_mesh")
-            || volume_1.mesh->getSettingBoolean("support_mesh")
-            || volume_1.mesh->getSettingAsSurfaceMode("magic_mesh_surface_mode") == ESurfaceMode::SURFACE
-            )
+        if (!is_carved[volume_1_idx])
         {
             continue;
         }
         for (unsigned int volume_2_idx = 0; volume_2_idx < volume_1_idx; volume_2_idx++)
         {
-            Slicer& volume_2 = *volumes[volume_2_idx];
-            if (volume_2.mesh->getSettingBoolean("infill_mesh")
-                || volume_2.mesh->getSettingBoolean("anti_overhang_mesh")
-                || volume_2.mesh->getSettingBoolean("support_mesh")
-                || volume_2.mesh->getSettingAsSurfaceMode("magic_mesh_surface_mode") == ESurfaceMode::SURFACE
-                )
+            if (!is_carved[volume_2_idx] || !volumes[volume_1_idx]->mesh->getAABB().hit(volumes[volume_2_idx]->mesh->getAABB()))
             {
                 continue;
             }
-            if (!volume_1.mesh->getAABB().hit(volume_2.mesh->getAABB()))
-            {
+            carve_pairs.emplace_back(volume_1_idx, volume_2_idx);
+        }
+    }
+    if (carve_pairs.empty())
+    {
+        return;
+    }
+
+    //Each layer is carved independently of the other layers.
+    const size_t layer_count = getMaxLayerCount(volumes);
+#pragma omp parallel for default(none) shared(volumes, is_carved, carve_pairs) firstprivate(layer_count, alternate_carve_order) schedule(dynamic)
+    for (unsigned int layer_nr = 0; layer_nr < layer_count; layer_nr++)
+    {
+        std::vector<AABB> boxes;
+        computeLayerBoundaryBoxes(volumes, is_carved, layer_nr, boxes);
+        for (const std::pair<unsigned int, unsigned int>& carve_pair : carve_pairs)
+        {
+            if (!boxes[carve_pair.first].hit(boxes[carve_pair.second]))
+            { // also skips the pairs where either layer is empty
                 continue;
             }
-            for (unsigned int layerNr = 0; layerNr < volume_1.layers.size(); layerNr++)
+            SlicerLayer& layer1 = volumes[carve_pair.first]->layers[layer_nr];
+            SlicerLayer& layer2 = volumes[carve_pair.second]->layers[layer_nr];
+            if (alternate_carve_order && layer_nr % 2 == 0)
             {
-                SlicerLayer& layer1 = volume_1.layers[layerNr];
-                SlicerLayer& layer2 = volume_2.layers[layerNr];
-                if (alternate_carve_order && layerNr % 2 == 0)
-                {
-                    layer2.polygons = layer2.polygons.difference(layer1.polygons);
-                }
-                else
-                {
-                    layer1.polygons = layer1.polygons.difference(layer2.polygons);
-                }
+                layer2.polygons = layer2.polygons.difference(layer1.polygons);
+            }
+            else
+            {
+                layer1.polygons = layer1.polygons.difference(layer2.polygons);
             }
         }
     }
 }
- 
+
 //Expand each layer a bit and then keep the extra overlapping parts that overlap with other volumes.
 //This generates some overlap in dual extrusion, for better bonding in touching parts.
 void generateMultipleVolumesOverlap(std::vector<Slicer*> &volumes)
@@ -61,68 +117,126 @@ void generateMultipleVolumesOverlap(std::vector<Slicer*> &volumes)
         return;
     }
 
-    int offset_to_merge_other_merged_volumes = 20;
-    for (Slicer* volume : volumes)
+    const coord_t offset_to_merge_other_merged_volumes = 20;
+    const double miter_limit = 1.2; // the miter limit of Polygons::offset, with which a corner can end up further away than the offset distance
+    std::vector<bool> is_other_volume(volumes.size()); // whether each volume can overlap with other volumes
+    std::vector<coord_t> overlaps(volumes.size()); // the overlap of each volume, or zero if it is not expanded
+    for (unsigned int volume_idx = 0; volume_idx < volumes.size(); volume_idx++)
     {
-        int overlap = volume->mesh->getSettingInMicrons("multiple_mesh_overlap");
-        if (volume->mesh->getSettingBoolean("infill_mesh")
-            || volume->mesh->getSettingBoolean("anti_overhang_mesh")
-            || volume->mesh->getSettingBoolean("support_mesh")
-            || overlap == 0)
+        const Mesh& mesh = *volumes[volume_idx]->mesh;
+        is_other_volume[volume_idx] = !mesh.getSettingBoolean("infill_mesh")
+            && !mesh.getSettingBoolean("anti_overhang_mesh")
+            && !mesh.getSettingBoolean("support_mesh");
+        overlaps[volume_idx] = is_other_volume[volume_idx] ? mesh.getSettingInMicrons("multiple_mesh_overlap") : 0;
+    }
+
+    //For each volume in order, the other volumes of which the 3D boundary boxes are close enough to overlap with it.
+    std::vector<std::vector<unsigned int>> other_volumes_per_volume(volumes.size());
+    bool has_overlap = false;
+    for (unsigned int volume_idx = 0; volume_idx < volumes.size(); volume_idx++)
+    {
+        if (overlaps[volume_idx] == 0)
         {
             continue;
         }
-        AABB3D aabb(volume->mesh->getAABB());
-        aabb.expandXY(overlap); // expand to account for the case where two models and their bounding boxes are adjacent along the X or Y-direction
-        for (unsigned int layer_nr = 0; layer_nr < volume->layers.size(); layer_nr++)
+        AABB3D aabb(volumes[volume_idx]->mesh->getAABB());
+        aabb.expandXY(overlaps[volume_idx]); // expand to account for the case where two models and their bounding boxes are adjacent along the X or Y-direction
+        for (unsigned int other_volume_idx = 0; other_volume_idx < volumes.size(); other_volume_idx++)
+        {
+            if (is_other_volume[other_volume_idx] && other_volume_idx != volume_idx && volumes[other_volume_idx]->mesh->getAABB().hit(aabb))
+            {
+                other_volumes_per_volume[volume_idx].push_back(other_volume_idx);
+                has_overlap = true;
+            }
+        }
+    }
+    if (!has_overlap)
+    {
+        return;
+    }
+
+    //Each layer is expanded independently of the other layers, but the volumes in a layer are expanded one after the other.
+    const size_t layer_count = getMaxLayerCount(volumes);
+#pragma omp parallel for default(none) shared(volumes, is_other_volume, overlaps, other_volumes_per_volume) firstprivate(layer_count) schedule(dynamic)
+    for (unsigned int layer_nr = 0; layer_nr < layer_count; layer_nr++)
+    {
+        std::vector<AABB> boxes;
+        computeLayerBoundaryBoxes(volumes, is_other_volume, layer_nr, boxes);
+        for (unsigned int volume_idx = 0; volume_idx < volumes.size(); volume_idx++)
         {
+            const coord_t overlap = overlaps[volume_idx];
+            if (overlap == 0 || layer_nr >= volumes[volume_idx]->layers.size())
+            {
+                continue;
+            }
+            AABB expanded_box = boxes[volume_idx]; // both outlines are offset with mitered corners, so expand by the furthest such a corner can reach
+            expanded_box.expand(std::ceil(miter_limit * (overlap / 2 + offset_to_merge_other_merged_volumes)) + 1); // +1 for the rounding to whole microns
             Polygons all_other_volumes;
-            for (Slicer* other_volume : volumes)
+            for (const unsigned int other_volume_idx : other_volumes_per_volume[volume_idx])
             {
-                if (other_volume->mesh->getSettingBoolean("infill_mesh")
-                    || other_volume->mesh->getSettingBoolean("anti_overhang_mesh")
-                    || other_volume->mesh->getSettingBoolean("support_mesh")
-                    || !other_volume->mesh->getAABB().hit(aabb)
-                    || other_volume == volume
-                )
-                {
+                if (!expanded_box.hit(boxes[other_volume_idx]))
+                { // the other volume is too far away for its offset outline to touch the expanded outline of this volume
                     continue;
                 }
-                SlicerLayer& other_volume_layer = other_volume->layers[layer_nr];
+                SlicerLayer& other_volume_layer = volumes[other_volume_idx]->layers[layer_nr];
                 all_other_volumes = all_other_volumes.unionPolygons(other_volume_layer.polygons.offset(offset_to_merge_other_merged_volumes));
             }
+            if (all_other_volumes.empty())
+            {
+                continue;
+            }
 
-            SlicerLayer& volume_layer = volume->layers[layer_nr];
+            SlicerLayer& volume_layer = volumes[volume_idx]->layers[layer_nr];
             volume_layer.polygons = volume_layer.polygons.unionPolygons(all_other_volumes.intersection(volume_layer.polygons.offset(overlap / 2)));
+            boxes[volume_idx].calculate(volume_layer.polygons); // this layer has grown, so it may now overlap with more of the volumes after it
         }
     }
 }
 
 void MultiVolumes::carveCuttingMeshes(std::vector<Slicer*>& volumes, const std::vector<Mesh>& meshes)
 {
-    for (unsigned int carving_mesh_idx = 0; carving_mesh_idx < volumes.size(); carving_mesh_idx++)
+    std::vector<bool> is_cutting_mesh(volumes.size());
+    std::vector<bool> is_carved_mesh(volumes.size());
+    std::vector<bool> takes_part(volumes.size());
+    bool has_cutting_mesh = false;
+    for (unsigned int mesh_idx = 0; mesh_idx < volumes.size(); mesh_idx++)
     {
-        const Mesh& cutting_mesh = meshes[carving_mesh_idx];
-        if (!cutting_mesh.getSettingBoolean("cutting_mesh"))
-        {
-            continue;
-        }
-        Slicer& cutting_mesh_volume = *volumes[carving_mesh_idx];
-        for (unsigned int layer_nr = 0; layer_nr < cutting_mesh_volume.layers.size(); layer_nr++)
+        const Mesh& mesh = meshes[mesh_idx];
+        is_cutting_mesh[mesh_idx] = mesh.getSettingBoolean("cutting_mesh");
+        //Do not apply cutting_mesh for meshes which have settings (cutting_mesh, anti_overhang_mesh, support_mesh).
+        is_carved_mesh[mesh_idx] = !is_cutting_mesh[mesh_idx]
+            && !mesh.getSettingBoolean("anti_overhang_mesh")
+            && !mesh.getSettingBoolean("support_mesh");
+        takes_part[mesh_idx] = is_cutting_mesh[mesh_idx] || is_carved_mesh[mesh_idx];
+        has_cutting_mesh |= is_cutting_mesh[mesh_idx];
+    }
+    if (!has_cutting_mesh)
+    {
+        return;
+    }
+
+    //Each layer is cut independently of the other layers, but the cutting meshes in a layer cut one after the other.
+    const size_t layer_count = getMaxLayerCount(volumes);
+#pragma omp parallel for default(none) shared(volumes, is_cutting_mesh, is_carved_mesh, takes_part) firstprivate(layer_count) schedule(dynamic)
+    for (unsigned int layer_nr = 0; layer_nr < layer_count; layer_nr++)
+    {
+        std::vector<AABB> boxes;
+        computeLayerBoundaryBoxes(volumes, takes_part, layer_nr, boxes);
+        for (unsigned int carving_mesh_idx = 0; carving_mesh_idx < volumes.size(); carving_mesh_idx++)
         {
-            Polygons& cutting_mesh_layer = cutting_mesh_volume.layers[layer_nr].polygons;
+            if (!is_cutting_mesh[carving_mesh_idx] || layer_nr >= volumes[carving_mesh_idx]->layers.size())
+            {
+                continue;
+            }
+            Polygons& cutting_mesh_layer = volumes[carving_mesh_idx]->layers[layer_nr].polygons;
             Polygons new_outlines;
             for (unsigned int carved_mesh_idx = 0; carved_mesh_idx < volumes.size(); carved_mesh_idx++)
             {
-                const Mesh& carved_mesh = meshes[carved_mesh_idx];
-                //Do not apply cutting_mesh for meshes which have settings (cutting_mesh, anti_overhang_mesh, support_mesh).
-                if (carved_mesh.getSettingBoolean("cutting_mesh") || carved_mesh.getSettingBoolean("anti_overhang_mesh")
-                    || carved_mesh.getSettingBoolean("support_mesh"))
-                {
+                if (!is_carved_mesh[carved_mesh_idx] || !boxes[carving_mesh_idx].hit(boxes[carved_mesh_idx]))
+                { // disjoint layers have an empty intersection and leave the carved layer as it is
                     continue;
                 }
-                Slicer& carved_volume = *volumes[carved_mesh_idx];
-                Polygons& carved_mesh_layer = carved_volume.layers[layer_nr].polygons;
+                Polygons& carved_mesh_layer = volumes[carved_mesh_idx]->layers[layer_nr].polygons;
                 Polygons intersection = cutting_mesh_layer.intersection(carved_mesh_layer);
                 new_outlines.add(intersection);
                 carved_mesh_layer = carved_mesh_layer.difference(cutting_mesh_layer);
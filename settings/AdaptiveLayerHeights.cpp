@@ -205,9 +205,9 @@ void AdaptiveLayerHeights::calculateMeshTriangleSlopes()
             const MeshVertex& v1 = mesh.vertices[face.vertex_index[1]];
             const MeshVertex& v2 = mesh.vertices[face.vertex_index[2]];
 
-            FPoint3 p0 = v0.p;
-            FPoint3 p1 = v1.p;
-            FPoint3 p2 = v2.p;
+            FPoint3 p0(v0.p);
+            FPoint3 p1(v1.p);
+            FPoint3 p2(v2.p);
 
             float minZ = p0.z;
             float maxZ = p0.z;
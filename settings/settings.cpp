@@ -45,16 +45,261 @@ std::string toString(EGCodeFlavor flavor)
     }
 }
 
+/*!
+ * The names of all interned setting keys, in order of their index.
+ *
+ * A function-local static, so that keys can be interned during static initialization of other translation units.
+ */
+static std::vector<std::string>& internedSettingNames()
+{
+    static std::vector<std::string> names;
+    return names;
+}
+
+SettingKey::SettingKey(const std::string& name)
+: key_name(name)
+{
+    static std::unordered_map<std::string, unsigned int> key_indices;
+#pragma omp critical (setting_key_indices)
+    {
+        std::vector<std::string>& names = internedSettingNames();
+        const std::pair<std::unordered_map<std::string, unsigned int>::iterator, bool> emplaced = key_indices.emplace(name, names.size());
+        if (emplaced.second)
+        {
+            names.push_back(name);
+        }
+        key_index = emplaced.first->second;
+    }
+}
+
+std::vector<std::string> SettingKey::getInternedNames()
+{
+    std::vector<std::string> ret;
+#pragma omp critical (setting_key_indices)
+    {
+        ret = internedSettingNames();
+    }
+    return ret;
+}
+
+//! Keys used by the conversions below
+static const SettingKey extruder_nr_key("extruder_nr");
+static const SettingKey machine_extruder_count_key("machine_extruder_count");
+
+/*!
+ * Interpret the text of a setting as a boolean.
+ */
+static bool parseBoolean(const std::string& value)
+{
+    if (value == "on")
+        return true;
+    if (value == "yes")
+        return true;
+    if (value == "true" or value == "True") //Python uses "True"
+        return true;
+    int num = atoi(value.c_str());
+    return num != 0;
+}
+
+ParsedSettingValue ParsedSettingValue::parse(const std::string& value)
+{
+    ParsedSettingValue ret;
+    ret.number = atof(value.c_str());
+    ret.integer = atoi(value.c_str());
+    ret.boolean = parseBoolean(value);
+    return ret;
+}
+
+/*!
+ * The generation of all settings, incremented whenever any setting, inheritance base or parent changes.
+ * Cached values are only valid for the generation for which they were parsed.
+ * Starts at 1 so that zero-initialized cache entries are invalid.
+ */
+static std::atomic<unsigned int> settings_generation(1);
+
+struct SettingsBaseVirtual::CachedSettingValue
+{
+    std::atomic<unsigned int> generation; //!< The settings generation for which the value was parsed, or 0 if it never was
+    std::atomic<double> number;
+    std::atomic<int> integer;
+    std::atomic<bool> boolean;
+};
+
+struct SettingsBaseVirtual::FrozenSettings
+{
+    unsigned int generation; //!< The settings generation for which the values were resolved
+    std::vector<ParsedSettingValue> values; //!< The value per SettingKey index
+    std::vector<bool> has_value; //!< Whether a value was given for each SettingKey index
+};
+
 SettingsBaseVirtual::SettingsBaseVirtual()
 : parent(nullptr)
+, setting_value_cache(nullptr)
+{
+}
+
+std::atomic<SettingsReadRecorder*> SettingsReadRecorder::active_recorder(nullptr);
+
+SettingsReadRecorder::SettingsReadRecorder()
+{
+    for (std::atomic<bool>& is_read : is_key_read)
+    {
+        is_read.store(false, std::memory_order_relaxed);
+    }
+    SettingsReadRecorder* no_recorder = nullptr;
+    is_active = active_recorder.compare_exchange_strong(no_recorder, this, std::memory_order_acq_rel);
+    if (!is_active)
+    {
+        logWarning("Settings are already being recorded, so no reads will be recorded.\n");
+    }
+}
+
+SettingsReadRecorder::~SettingsReadRecorder()
+{
+    if (is_active)
+    {
+        active_recorder.store(nullptr, std::memory_order_release);
+    }
+}
+
+void SettingsReadRecorder::record(const std::string& key)
 {
+#pragma omp critical (settings_read_recorder)
+    read_names.insert(key);
+}
+
+void SettingsReadRecorder::record(const SettingKey& key)
+{
+    if (key.index() >= SettingKey::max_cached_keys)
+    {
+        record(key.name());
+        return;
+    }
+    std::atomic<bool>& is_read = is_key_read[key.index()];
+    if (!is_read.load(std::memory_order_relaxed)) // only write once, so that the threads reading the same keys don't contend for the cache line
+    {
+        is_read.store(true, std::memory_order_relaxed);
+    }
+}
+
+std::vector<std::string> SettingsReadRecorder::getReadSettings() const
+{
+    std::set<std::string> names;
+#pragma omp critical (settings_read_recorder)
+    names = read_names;
+    const std::vector<std::string> interned_names = SettingKey::getInternedNames();
+    for (unsigned int key_idx = 0; key_idx < interned_names.size() && key_idx < SettingKey::max_cached_keys; key_idx++)
+    {
+        if (is_key_read[key_idx].load(std::memory_order_relaxed))
+        {
+            names.insert(interned_names[key_idx]);
+        }
+    }
+    return std::vector<std::string>(names.begin(), names.end());
 }
 
 SettingsBaseVirtual::SettingsBaseVirtual(SettingsBaseVirtual* parent)
 : parent(parent)
+, setting_value_cache(nullptr)
 {
 }
 
+SettingsBaseVirtual::SettingsBaseVirtual(const SettingsBaseVirtual& other)
+: parent(other.parent)
+, setting_value_cache(nullptr)
+{
+}
+
+SettingsBaseVirtual& SettingsBaseVirtual::operator=(const SettingsBaseVirtual& other)
+{
+    parent = other.parent;
+    frozen_settings.reset();
+    invalidateSettingCaches();
+    return *this;
+}
+
+SettingsBaseVirtual::~SettingsBaseVirtual()
+{
+    delete[] setting_value_cache.load();
+}
+
+void SettingsBaseVirtual::setParent(SettingsBaseVirtual* parent)
+{
+    this->parent = parent;
+    invalidateSettingCaches();
+}
+
+void SettingsBaseVirtual::invalidateSettingCaches()
+{
+    settings_generation++;
+}
+
+void SettingsBaseVirtual::freezeSettings()
+{
+    const std::vector<std::string> names = SettingKey::getInternedNames();
+    FrozenSettings* frozen = new FrozenSettings();
+    frozen->generation = settings_generation.load(std::memory_order_acquire);
+    frozen->values.resize(names.size());
+    frozen->has_value.resize(names.size(), false);
+    for (unsigned int key_idx = 0; key_idx < names.size(); key_idx++)
+    {
+        const std::string* value = findSettingString(names[key_idx]);
+        if (value)
+        {
+            frozen->values[key_idx] = ParsedSettingValue::parse(*value);
+            frozen->has_value[key_idx] = true;
+        }
+    }
+    frozen_settings.reset(frozen);
+}
+
+ParsedSettingValue SettingsBaseVirtual::getParsedSetting(const SettingKey& key) const
+{
+    SettingsReadRecorder::recordRead(key);
+    const FrozenSettings* frozen = frozen_settings.get();
+    if (frozen
+        && key.index() < frozen->values.size()
+        && frozen->has_value[key.index()]
+        && frozen->generation == settings_generation.load(std::memory_order_relaxed))
+    {
+        return frozen->values[key.index()];
+    }
+    if (key.index() >= SettingKey::max_cached_keys)
+    {
+        return ParsedSettingValue::parse(getSettingString(key.name()));
+    }
+    CachedSettingValue* cache = setting_value_cache.load(std::memory_order_acquire);
+    if (!cache)
+    {
+        CachedSettingValue* new_cache = new CachedSettingValue[SettingKey::max_cached_keys]();
+        if (setting_value_cache.compare_exchange_strong(cache, new_cache, std::memory_order_acq_rel))
+        {
+            cache = new_cache;
+        }
+        else
+        { // another thread allocated the cache first, which is now in cache
+            delete[] new_cache;
+        }
+    }
+
+    CachedSettingValue& cached = cache[key.index()];
+    const unsigned int generation = settings_generation.load(std::memory_order_acquire);
+    ParsedSettingValue ret;
+    if (cached.generation.load(std::memory_order_acquire) == generation)
+    {
+        ret.number = cached.number.load(std::memory_order_relaxed);
+        ret.integer = cached.integer.load(std::memory_order_relaxed);
+        ret.boolean = cached.boolean.load(std::memory_order_relaxed);
+        return ret;
+    }
+    ret = ParsedSettingValue::parse(getSettingString(key.name()));
+    cached.number.store(ret.number, std::memory_order_relaxed);
+    cached.integer.store(ret.integer, std::memory_order_relaxed);
+    cached.boolean.store(ret.boolean, std::memory_order_relaxed);
+    cached.generation.store(generation, std::memory_order_release);
+    return ret;
+}
+
 SettingsBase::SettingsBase()
 : SettingsBaseVirtual(nullptr)
 {
@@ -73,6 +318,7 @@ SettingsMessenger::SettingsMessenger(SettingsBaseVirtual* parent)
 void SettingsBase::_setSetting(std::string key, std::string value)
 {
     setting_values[key] = value;
+    invalidateSettingCaches();
 }
 
 
@@ -92,24 +338,36 @@ void SettingsBase::setSetting(std::string key, std::string value)
 void SettingsBase::setSettingInheritBase(std::string key, const SettingsBaseVirtual& parent)
 {
     setting_inherit_base.emplace(key, &parent);
+    invalidateSettingCaches();
 }
 
 
-const std::string& SettingsBase::getSettingString(const std::string& key) const
+const std::string* SettingsBase::findSettingString(const std::string& key) const
 {
     auto value_it = setting_values.find(key);
     if (value_it != setting_values.end())
     {
-        return value_it->second;
+        return &value_it->second;
     }
     auto inherit_override_it = setting_inherit_base.find(key);
     if (inherit_override_it != setting_inherit_base.end())
     {
-        return inherit_override_it->second->getSettingString(key);
+        return inherit_override_it->second->findSettingString(key);
     }
     if (parent)
     {
-        return parent->getSettingString(key);
+        return parent->findSettingString(key);
+    }
+    return nullptr;
+}
+
+const std::string& SettingsBase::getSettingString(const std::string& key) const
+{
+    SettingsReadRecorder::recordRead(key);
+    const std::string* value = findSettingString(key);
+    if (value)
+    {
+        return *value;
     }
 
     cura::logError("Trying to retrieve unregistered setting with no value given: '%s'\n", key.c_str());
@@ -149,6 +407,11 @@ const std::string& SettingsMessenger::getSettingString(const std::string& key) c
     return parent->getSettingString(key);
 }
 
+const std::string* SettingsMessenger::findSettingString(const std::string& key) const
+{
+    return parent->findSettingString(key);
+}
+
 int SettingsBaseVirtual::getSettingAsIndex(std::string key) const
 {
     const std::string& value = getSettingString(key);
@@ -160,9 +423,9 @@ int SettingsBaseVirtual::getSettingAsExtruderNr(std::string key) const
     int extruder_nr = getSettingAsIndex(key);
     if (extruder_nr == -1)
     {
-        extruder_nr = getSettingAsIndex("extruder_nr");
+        extruder_nr = getSettingAsIndex(extruder_nr_key);
     }
-    const int max_extruders = getSettingAsCount("machine_extruder_count");
+    const int max_extruders = getSettingAsCount(machine_extruder_count_key);
     if (extruder_nr >= max_extruders)
     {
         cura::logWarning("Trying to get extruder %s=%i, while there are only %i extruders.\n", key.c_str(), extruder_nr, max_extruders);
@@ -214,14 +477,7 @@ double SettingsBaseVirtual::getSettingInAngleRadians(std::string key) const
 bool SettingsBaseVirtual::getSettingBoolean(std::string key) const
 {
     const std::string& value = getSettingString(key);
-    if (value == "on")
-        return true;
-    if (value == "yes")
-        return true;
-    if (value == "true" or value == "True") //Python uses "True"
-        return true;
-    int num = atoi(value.c_str());
-    return num != 0;
+    return parseBoolean(value);
 }
 
 double SettingsBaseVirtual::getSettingInDegreeCelsius(std::string key) const
@@ -557,6 +813,17 @@ SlicingTolerance SettingsBaseVirtual::getSettingAsSlicingTolerance(std::string k
     return SlicingTolerance::MIDDLE;
 }
 
+SkinWindowAlgorithm SettingsBaseVirtual::getSettingAsSkinWindowAlgorithm(std::string key) const
+{
+    SettingsReadRecorder::recordRead(key);
+    const std::string* value = findSettingString(key); // the front-end doesn't send this setting, so it may not be given
+    if (value && *value == "sliding_window")
+    {
+        return SkinWindowAlgorithm::SLIDING_WINDOW;
+    }
+    return SkinWindowAlgorithm::PER_LAYER;
+}
+
 std::vector<int> SettingsBaseVirtual::getSettingAsIntegerList(std::string key) const
 {
     std::vector<int> result;
@@ -592,5 +859,86 @@ std::vector<int> SettingsBaseVirtual::getSettingAsIntegerList(std::string key) c
     return result;
 }
 
+int SettingsBaseVirtual::getSettingAsIndex(const SettingKey& key) const
+{
+    return getParsedSetting(key).integer;
+}
+
+int SettingsBaseVirtual::getSettingAsCount(const SettingKey& key) const
+{
+    return getParsedSetting(key).integer;
+}
+
+int SettingsBaseVirtual::getSettingAsExtruderNr(const SettingKey& key) const
+{
+    int extruder_nr = getSettingAsIndex(key);
+    if (extruder_nr == -1)
+    {
+        extruder_nr = getSettingAsIndex(extruder_nr_key);
+    }
+    const int max_extruders = getSettingAsCount(machine_extruder_count_key);
+    if (extruder_nr >= max_extruders)
+    {
+        cura::logWarning("Trying to get extruder %s=%i, while there are only %i extruders.\n", key.name().c_str(), extruder_nr, max_extruders);
+        return 0;
+    }
+    return extruder_nr;
+}
+
+double SettingsBaseVirtual::getSettingInAngleDegrees(const SettingKey& key) const
+{
+    return getParsedSetting(key).number;
+}
+
+double SettingsBaseVirtual::getSettingInAngleRadians(const SettingKey& key) const
+{
+    return getParsedSetting(key).number / 180.0 * M_PI;
+}
+
+double SettingsBaseVirtual::getSettingInMillimeters(const SettingKey& key) const
+{
+    return getParsedSetting(key).number;
+}
+
+coord_t SettingsBaseVirtual::getSettingInMicrons(const SettingKey& key) const
+{
+    return MM2INT(getParsedSetting(key).number);
+}
+
+bool SettingsBaseVirtual::getSettingBoolean(const SettingKey& key) const
+{
+    return getParsedSetting(key).boolean;
+}
+
+double SettingsBaseVirtual::getSettingInDegreeCelsius(const SettingKey& key) const
+{
+    return getParsedSetting(key).number;
+}
+
+double SettingsBaseVirtual::getSettingInMillimetersPerSecond(const SettingKey& key) const
+{
+    return std::max(0.0, getParsedSetting(key).number);
+}
+
+double SettingsBaseVirtual::getSettingInCubicMillimeters(const SettingKey& key) const
+{
+    return getParsedSetting(key).number;
+}
+
+double SettingsBaseVirtual::getSettingInPercentage(const SettingKey& key) const
+{
+    return std::max(0.0, getParsedSetting(key).number);
+}
+
+double SettingsBaseVirtual::getSettingAsRatio(const SettingKey& key) const
+{
+    return getParsedSetting(key).number / 100.0;
+}
+
+double SettingsBaseVirtual::getSettingInSeconds(const SettingKey& key) const
+{
+    return std::max(0.0, getParsedSetting(key).number);
+}
+
 }//namespace cura
 
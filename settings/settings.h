@@ -4,9 +4,12 @@
 #ifndef SETTINGS_SETTINGS_H
 #define SETTINGS_SETTINGS_H
 
+#include <atomic>
+#include <memory> // unique_ptr
 #include <vector>
 #include <map>
 #include <unordered_map>
+#include <set>
 #include <sstream>
 
 #include "../utils/floatpoint.h"
@@ -211,6 +214,15 @@ enum class SlicingTolerance
     EXCLUSIVE
 };
 
+/*!
+ * How the areas which are not air above and below each layer are computed for the top and bottom skin.
+ */
+enum class SkinWindowAlgorithm
+{
+    PER_LAYER, //Each layer intersects the walls of all layers in its window.
+    SLIDING_WINDOW //The intersections of all windows of a mesh are computed at once, reusing the intersections shared by neighbouring windows.
+};
+
 #define MAX_EXTRUDERS 16
 
 //Maximum number of infill layers that can be combined into a single infill extrusion area.
@@ -218,6 +230,116 @@ enum class SlicingTolerance
     
 class SettingsBase;
 
+/*!
+ * The name of a setting, interned as a small integer.
+ *
+ * Looking up a setting by its key rather than by its name lets each settings object cache the parsed value,
+ * so that hot code neither hashes the name nor parses the text of the value on every call.
+ * Interning a name takes a lock, so keys should be constructed once, e.g. as static objects next to the code which uses them.
+ */
+class SettingKey
+{
+public:
+    /*!
+     * The number of keys for which values are cached.
+     * Lookups with keys interned beyond this many names still work, but aren't cached.
+     */
+    static constexpr unsigned int max_cached_keys = 512;
+
+    explicit SettingKey(const std::string& name); //!< Intern a setting name
+
+    /*!
+     * Get the names of all keys interned so far, in order of their index.
+     */
+    static std::vector<std::string> getInternedNames();
+
+    const std::string& name() const
+    {
+        return key_name;
+    }
+
+    unsigned int index() const
+    {
+        return key_index;
+    }
+
+private:
+    std::string key_name; //!< The name of the setting
+    unsigned int key_index; //!< The index of the name, the same for all keys with the same name
+};
+
+/*!
+ * The value of a setting, parsed into all basic types in which it can be requested.
+ */
+struct ParsedSettingValue
+{
+    double number; //!< The value as parsed by atof
+    int integer; //!< The value as parsed by atoi
+    bool boolean; //!< The value interpreted as a boolean, see \ref SettingsBaseVirtual::getSettingBoolean
+
+    /*!
+     * Parse the text of a setting value.
+     */
+    static ParsedSettingValue parse(const std::string& value);
+};
+
+/*!
+ * Records which settings are read while it exists, e.g. to find out which settings a stage of the slicing depends on.
+ *
+ * Reads are recorded by name, from any settings object and from any thread.
+ * Only one recorder is active at a time: a recorder created while another one is active records nothing.
+ */
+class SettingsReadRecorder
+{
+public:
+    SettingsReadRecorder(); //!< Start recording
+    ~SettingsReadRecorder(); //!< Stop recording
+
+    SettingsReadRecorder(const SettingsReadRecorder&) = delete;
+    SettingsReadRecorder& operator=(const SettingsReadRecorder&) = delete;
+
+    /*!
+     * Get the names of the settings read so far, in alphabetical order.
+     */
+    std::vector<std::string> getReadSettings() const;
+
+    /*!
+     * Record that a setting is read, if a recorder is active.
+     */
+    static void recordRead(const std::string& key)
+    {
+        SettingsReadRecorder* recorder = active_recorder.load(std::memory_order_acquire);
+        if (recorder)
+        {
+            recorder->record(key);
+        }
+    }
+
+    /*!
+     * Record that a setting is read by its key, if a recorder is active.
+     *
+     * Interned keys are recorded without taking a lock, since they are read the most.
+     */
+    static void recordRead(const SettingKey& key)
+    {
+        SettingsReadRecorder* recorder = active_recorder.load(std::memory_order_acquire);
+        if (recorder)
+        {
+            recorder->record(key);
+        }
+    }
+
+private:
+    static std::atomic<SettingsReadRecorder*> active_recorder; //!< The recorder which records the reads, if any
+
+    bool is_active; //!< Whether this recorder is the active recorder
+    std::atomic<bool> is_key_read[SettingKey::max_cached_keys]; //!< For each interned key whether it has been read
+    std::set<std::string> read_names; //!< The names of the other settings which have been read
+
+    void record(const std::string& key);
+    void record(const SettingKey& key);
+};
+
 /*!
  * An abstract class for classes that can provide setting values.
  * These are: SettingsBase, which contains setting information 
@@ -229,6 +351,14 @@ protected:
     SettingsBaseVirtual* parent;
 public:
     virtual const std::string& getSettingString(const std::string& key) const = 0;
+
+    /*!
+     * Get the text of a setting from this object or any of its ancestors, if it has a value.
+     *
+     * \param key The setting to get
+     * \return The value of the setting, or nullptr if no value is given for it
+     */
+    virtual const std::string* findSettingString(const std::string& key) const = 0;
     
     virtual void setSetting(std::string key, std::string value) = 0;
 
@@ -241,13 +371,41 @@ public:
      */
     virtual void setSettingInheritBase(std::string key, const SettingsBaseVirtual& parent) = 0;
 
-    virtual ~SettingsBaseVirtual() {}
+    virtual ~SettingsBaseVirtual();
     
     SettingsBaseVirtual(); //!< SettingsBaseVirtual without a parent settings object
     SettingsBaseVirtual(SettingsBaseVirtual* parent); //!< construct a SettingsBaseVirtual with a parent settings object
+    SettingsBaseVirtual(const SettingsBaseVirtual& other); //!< Copies the parent, but not the cached setting values
+    SettingsBaseVirtual& operator=(const SettingsBaseVirtual& other); //!< Copies the parent, but not the cached setting values
     
-    void setParent(SettingsBaseVirtual* parent) { this->parent = parent; }
+    void setParent(SettingsBaseVirtual* parent);
     SettingsBaseVirtual* getParent() { return parent; }
+
+    /*!
+     * Get the parsed value of a setting, caching it in this object.
+     *
+     * The cached values are invalidated whenever any setting, inheritance base or parent changes anywhere.
+     * The cache may be filled from multiple threads at once, as long as no settings are changed at the same time.
+     *
+     * \param key The setting to get
+     * \return The parsed value of the setting
+     */
+    ParsedSettingValue getParsedSetting(const SettingKey& key) const;
+
+    /*!
+     * Register that a setting, inheritance base or parent has changed, which invalidates all cached setting values.
+     */
+    static void invalidateSettingCaches();
+
+    /*!
+     * Resolve the values of all interned settings into an immutable flat table.
+     *
+     * Until a setting, inheritance base or parent changes anywhere, lookups by SettingKey read from this table
+     * without walking the inheritance chain, parsing text or writing to the cache.
+     * Keys interned after this call and settings without a value are looked up as usual.
+     * Must not be called while other threads read the settings of this object.
+     */
+    void freezeSettings();
     
     int getSettingAsIndex(std::string key) const;
     int getSettingAsCount(std::string key) const;
@@ -296,7 +454,30 @@ public:
     CombingMode getSettingAsCombingMode(std::string key) const;
     SupportDistPriority getSettingAsSupportDistPriority(std::string key) const;
     SlicingTolerance getSettingAsSlicingTolerance(std::string key) const;
+    SkinWindowAlgorithm getSettingAsSkinWindowAlgorithm(std::string key) const; //!< Defaults to SkinWindowAlgorithm::PER_LAYER when the setting isn't given
     std::vector<int> getSettingAsIntegerList(std::string key) const;
+
+    // The same conversions, using the cached values of interned keys
+    int getSettingAsIndex(const SettingKey& key) const;
+    int getSettingAsCount(const SettingKey& key) const;
+    int getSettingAsExtruderNr(const SettingKey& key) const;
+    double getSettingInAngleDegrees(const SettingKey& key) const;
+    double getSettingInAngleRadians(const SettingKey& key) const;
+    double getSettingInMillimeters(const SettingKey& key) const;
+    coord_t getSettingInMicrons(const SettingKey& key) const;
+    bool getSettingBoolean(const SettingKey& key) const;
+    double getSettingInDegreeCelsius(const SettingKey& key) const;
+    double getSettingInMillimetersPerSecond(const SettingKey& key) const;
+    double getSettingInCubicMillimeters(const SettingKey& key) const;
+    double getSettingInPercentage(const SettingKey& key) const;
+    double getSettingAsRatio(const SettingKey& key) const; //!< For settings which are provided in percentage
+    double getSettingInSeconds(const SettingKey& key) const;
+
+private:
+    struct CachedSettingValue; //!< A ParsedSettingValue with the generation of the settings for which it was parsed
+    mutable std::atomic<CachedSettingValue*> setting_value_cache; //!< The cached values per SettingKey index, allocated on first use
+    struct FrozenSettings; //!< The values of all interned settings for one generation of the settings
+    std::unique_ptr<const FrozenSettings> frozen_settings; //!< The values resolved by \ref freezeSettings, if any
 };
 
 class SettingRegistry;
@@ -329,6 +510,7 @@ public:
     void setSetting(std::string key, std::string value);
     void setSettingInheritBase(std::string key, const SettingsBaseVirtual& parent); //!< See \ref SettingsBaseVirtual::setSettingInheritBase
     const std::string& getSettingString(const std::string& key) const; //!< Get a setting from this SettingsBase (or any ancestral SettingsBase)
+    const std::string* findSettingString(const std::string& key) const; //!< See \ref SettingsBaseVirtual::findSettingString
 
     /*!
      * Format a string that contains all settings and their values similar to a
@@ -365,6 +547,7 @@ public:
     void setSetting(std::string key, std::string value); //!< Set a setting of the parent SettingsBase to a given value
     void setSettingInheritBase(std::string key, const SettingsBaseVirtual& parent); //!< See \ref SettingsBaseVirtual::setSettingInheritBase
     const std::string& getSettingString(const std::string& key) const; //!< Get a setting from the parent SettingsBase (or any further ancestral SettingsBase)
+    const std::string* findSettingString(const std::string& key) const; //!< See \ref SettingsBaseVirtual::findSettingString
 };
 
 
@@ -2,10 +2,12 @@
 //Copyright (c) 2017 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> // std::max, std::min
 #include <cmath> // std::ceil
 
 #include "skin.h"
 #include "utils/math.h"
+#include "utils/BoundedPolygonOps.h"
 #include "utils/polygonUtils.h"
 
 #define MIN_AREA_SIZE (0.4 * 0.4) 
@@ -59,7 +61,81 @@ coord_t SkinInfillAreaComputation::getInfillSkinOverlap(const SliceDataStorage&
     return infill_skin_overlap;
 }
 
-SkinInfillAreaComputation::SkinInfillAreaComputation(int layer_nr, const SliceDataStorage& storage, SliceMeshStorage& mesh, bool process_infill)
+SkinWallsCache::SkinWallsCache(const SliceMeshStorage& mesh)
+: layers_below(std::max(1, mesh.getSettingAsCount("bottom_layers"))) // the roofing also reads the layer directly below
+, layers_above(std::max(0, std::max(mesh.getSettingAsCount("top_layers"), mesh.getSettingAsCount("roofing_layer_count"))))
+, entries_per_layer(mesh.layers.size())
+, unfinished_reader_count(mesh.layers.size())
+{
+    const int layer_count = mesh.layers.size();
+    for (int layer_nr = 0; layer_nr < layer_count; layer_nr++)
+    { // the walls of a layer are read by the layers from layers_above below it up to layers_below above it
+        unfinished_reader_count[layer_nr] = std::min(layer_nr + layers_below, layer_count - 1) - std::max(layer_nr - layers_above, 0) + 1;
+    }
+}
+
+const SkinWallsCache::Entry* SkinWallsCache::find(const std::vector<Entry>& entries, unsigned int wall_idx, coord_t expansion, const std::vector<unsigned int>& part_indices)
+{
+    for (const Entry& entry : entries)
+    {
+        if (entry.wall_idx == wall_idx && entry.expansion == expansion && entry.part_indices == part_indices)
+        {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const Polygons> SkinWallsCache::get(int layer_nr, unsigned int wall_idx, coord_t expansion, const std::vector<unsigned int>& part_indices) const
+{
+    std::shared_ptr<const Polygons> ret;
+#pragma omp critical (skin_walls_cache)
+    {
+        const Entry* entry = find(entries_per_layer[layer_nr], wall_idx, expansion, part_indices);
+        if (entry)
+        {
+            ret = entry->walls;
+        }
+    }
+    return ret;
+}
+
+std::shared_ptr<const Polygons> SkinWallsCache::insert(int layer_nr, unsigned int wall_idx, coord_t expansion, const std::vector<unsigned int>& part_indices, std::shared_ptr<const Polygons> walls)
+{
+#pragma omp critical (skin_walls_cache)
+    {
+        std::vector<Entry>& entries = entries_per_layer[layer_nr];
+        const Entry* entry = find(entries, wall_idx, expansion, part_indices);
+        if (entry)
+        { // another thread has computed the same walls in the meantime
+            walls = entry->walls;
+        }
+        else
+        {
+            entries.push_back(Entry{wall_idx, expansion, part_indices, walls});
+        }
+    }
+    return walls;
+}
+
+void SkinWallsCache::finishLayer(int layer_nr)
+{
+    const int first_read_layer_nr = std::max(layer_nr - layers_below, 0);
+    const int last_read_layer_nr = std::min(layer_nr + layers_above, static_cast<int>(entries_per_layer.size()) - 1);
+#pragma omp critical (skin_walls_cache)
+    {
+        for (int read_layer_nr = first_read_layer_nr; read_layer_nr <= last_read_layer_nr; read_layer_nr++)
+        {
+            unfinished_reader_count[read_layer_nr]--;
+            if (unfinished_reader_count[read_layer_nr] == 0)
+            {
+                std::vector<Entry>().swap(entries_per_layer[read_layer_nr]); // walls still used by a computation are kept alive by their shared_ptr
+            }
+        }
+    }
+}
+
+SkinInfillAreaComputation::SkinInfillAreaComputation(int layer_nr, const SliceDataStorage& storage, SliceMeshStorage& mesh, bool process_infill, SkinWallsCache* walls_cache, const SkinNotAirWindows* not_air_windows)
 : layer_nr(layer_nr)
 , mesh(mesh)
 , bottom_layer_count(mesh.getSettingAsCount("bottom_layers"))
@@ -73,6 +149,8 @@ SkinInfillAreaComputation::SkinInfillAreaComputation(int layer_nr, const SliceDa
 , skin_inset_count(mesh.getSettingAsCount("skin_outline_count"))
 , no_small_gaps_heuristic(mesh.getSettingBoolean("skin_no_small_gaps_heuristic"))
 , process_infill(process_infill)
+, walls_cache(walls_cache)
+, not_air_windows(not_air_windows)
 , top_reference_wall_expansion(mesh.getSettingInMicrons("top_skin_preshrink"))
 , bottom_reference_wall_expansion(mesh.getSettingInMicrons("bottom_skin_preshrink"))
 , top_skin_expand_distance(mesh.getSettingInMicrons("top_skin_expand_distance"))
@@ -113,6 +191,59 @@ Polygons SkinInfillAreaComputation::getWalls(const SliceLayerPart& part_here, in
     return result;
 };
 
+std::shared_ptr<const Polygons> SkinInfillAreaComputation::getExpandedWalls(const SliceLayerPart& part_here, int layer2_nr, unsigned int wall_idx, coord_t expansion)
+{
+    if (!walls_cache || layer2_nr < 0 || layer2_nr >= static_cast<int>(mesh.layers.size()))
+    {
+        return std::make_shared<const Polygons>(getWalls(part_here, layer2_nr, wall_idx).offset(expansion));
+    }
+    const SliceLayer& layer2 = mesh.layers[layer2_nr];
+    std::vector<unsigned int> part_indices;
+    for (unsigned int part_idx = 0; part_idx < layer2.parts.size(); part_idx++)
+    {
+        if (part_here.boundaryBox.hit(layer2.parts[part_idx].boundaryBox))
+        {
+            part_indices.push_back(part_idx);
+        }
+    }
+    std::shared_ptr<const Polygons> walls = walls_cache->get(layer2_nr, wall_idx, expansion, part_indices);
+    if (walls)
+    {
+        return walls;
+    }
+    // gather the walls in the same order as getWalls does
+    Polygons result;
+    for (const unsigned int part_idx : part_indices)
+    {
+        const SliceLayerPart& part2 = layer2.parts[part_idx];
+        if (wall_idx <= 0)
+        {
+            result.add(part2.outline);
+        }
+        else if (wall_idx <= part2.insets.size())
+        {
+            result.add(part2.insets[wall_idx - 1]); // -1 because it's a 1-based index
+        }
+    }
+    return walls_cache->insert(layer2_nr, wall_idx, expansion, part_indices, std::make_shared<const Polygons>(result.offset(expansion)));
+}
+
+bool SkinInfillAreaComputation::hitsAllWalls(const SliceLayerPart& part_here, int first_layer_nr, int last_layer_nr, unsigned int wall_idx) const
+{
+    for (int layer2_nr = first_layer_nr; layer2_nr <= last_layer_nr; layer2_nr++)
+    {
+        for (const SliceLayerPart& part2 : mesh.layers[layer2_nr].parts)
+        {
+            const bool has_wall = wall_idx <= 0 || wall_idx <= part2.insets.size();
+            if (has_wall && !part_here.boundaryBox.hit(part2.boundaryBox))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 int SkinInfillAreaComputation::getReferenceWallIdx(coord_t& preshrink) const
 {
     for (int wall_idx = wall_line_count; wall_idx > 0; wall_idx--)
@@ -239,16 +370,144 @@ void SkinInfillAreaComputation::generateSkinAndInfillAreas(SliceLayerPart& part)
  *
  * this function may only read/write the skin and infill from the *current* layer.
  */
+/*!
+ * Get the walls of all parts of each layer, offset by an expansion.
+ *
+ * \param mesh The mesh from which to get the walls
+ * \param wall_idx The 1-based wall index for the walls to grab. Zero means the outline.
+ * \param expansion The offset to apply to the walls
+ * \return The expanded walls per layer
+ */
+static std::vector<Polygons> getExpandedLayerWalls(const SliceMeshStorage& mesh, const unsigned int wall_idx, const coord_t expansion)
+{
+    std::vector<Polygons> walls_per_layer(mesh.layers.size());
+#pragma omp parallel for default(none) shared(mesh, walls_per_layer) firstprivate(wall_idx, expansion) schedule(dynamic)
+    for (unsigned int layer_nr = 0; layer_nr < mesh.layers.size(); layer_nr++)
+    {
+        Polygons walls;
+        for (const SliceLayerPart& part : mesh.layers[layer_nr].parts)
+        {
+            if (wall_idx <= 0)
+            {
+                walls.add(part.outline);
+            }
+            else if (wall_idx <= part.insets.size())
+            {
+                walls.add(part.insets[wall_idx - 1]); // -1 because it's a 1-based index
+            }
+        }
+        walls_per_layer[layer_nr] = walls.offset(expansion);
+    }
+    return walls_per_layer;
+}
+
+/*!
+ * Intersect each window of consecutive layers.
+ *
+ * The layers are split into blocks of \p window_size layers, like the two stacks of a queue which are swapped at fixed layers.
+ * Within each block the intersection from each layer up to the end of the block (the suffix) and from the start of the block up to each layer (the prefix) is computed.
+ * A window starting at the start of a block is the suffix of that layer; any other window is the suffix of its first layer intersected with the prefix of its last layer.
+ * The blocks are independent of each other, and so are the windows once the blocks are done.
+ *
+ * \param layers The areas of each layer
+ * \param window_size The number of consecutive layers in a window
+ * \return For each layer the intersection of the window starting at that layer, or empty polygons if there are fewer layers from that layer on than in a window
+ */
+static std::vector<Polygons> intersectWindows(const std::vector<Polygons>& layers, const unsigned int window_size)
+{
+    std::vector<Polygons> windows(layers.size());
+    if (window_size == 0 || layers.size() < window_size)
+    {
+        return windows;
+    }
+    std::vector<Polygons> suffixes(layers.size());
+    std::vector<Polygons> prefixes(layers.size());
+    const unsigned int block_count = (layers.size() + window_size - 1) / window_size;
+#pragma omp parallel for default(none) shared(layers, suffixes, prefixes) firstprivate(window_size, block_count) schedule(dynamic)
+    for (unsigned int block_idx = 0; block_idx < block_count; block_idx++)
+    {
+        const unsigned int block_start = block_idx * window_size;
+        const unsigned int block_end = std::min(static_cast<size_t>(block_start + window_size), layers.size());
+        prefixes[block_start] = layers[block_start];
+        for (unsigned int layer_nr = block_start + 1; layer_nr < block_end; layer_nr++)
+        {
+            prefixes[layer_nr] = BoundedPolygonOps::intersection(prefixes[layer_nr - 1], layers[layer_nr]);
+        }
+        suffixes[block_end - 1] = layers[block_end - 1];
+        for (unsigned int layer_nr = block_end - 1; layer_nr > block_start; layer_nr--)
+        {
+            suffixes[layer_nr - 1] = BoundedPolygonOps::intersection(layers[layer_nr - 1], suffixes[layer_nr]);
+        }
+    }
+    const unsigned int window_count = layers.size() - window_size + 1;
+#pragma omp parallel for default(none) shared(windows, suffixes, prefixes) firstprivate(window_size, window_count) schedule(dynamic)
+    for (unsigned int window_start = 0; window_start < window_count; window_start++)
+    {
+        if (window_start % window_size == 0)
+        {
+            windows[window_start] = suffixes[window_start];
+        }
+        else
+        {
+            windows[window_start] = BoundedPolygonOps::intersection(suffixes[window_start], prefixes[window_start + window_size - 1]);
+        }
+    }
+    return windows;
+}
+
+void SkinInfillAreaComputation::generateNotAirWindows(SkinNotAirWindows& not_air_windows)
+{
+    if (no_small_gaps_heuristic)
+    { // only a single layer above and below is looked at
+        return;
+    }
+    const size_t layer_count = mesh.layers.size();
+    if (top_layer_count > 0)
+    {
+        not_air_windows.has_above = true;
+        not_air_windows.top_reference_wall_idx = top_reference_wall_idx;
+        not_air_windows.top_reference_wall_expansion = top_reference_wall_expansion;
+        std::vector<Polygons> windows = intersectWindows(getExpandedLayerWalls(mesh, top_reference_wall_idx, top_reference_wall_expansion), top_layer_count);
+        not_air_windows.above.resize(layer_count);
+        for (unsigned int layer_nr = 0; layer_nr + top_layer_count < layer_count; layer_nr++)
+        {
+            not_air_windows.above[layer_nr] = std::move(windows[layer_nr + 1]); // the window starting at the layer above
+        }
+    }
+    if (bottom_layer_count > 0)
+    {
+        not_air_windows.has_below = true;
+        not_air_windows.bottom_reference_wall_idx = bottom_reference_wall_idx;
+        not_air_windows.bottom_reference_wall_expansion = bottom_reference_wall_expansion;
+        std::vector<Polygons> windows = intersectWindows(getExpandedLayerWalls(mesh, bottom_reference_wall_idx, bottom_reference_wall_expansion), bottom_layer_count);
+        not_air_windows.below.resize(layer_count);
+        for (unsigned int layer_nr = bottom_layer_count; layer_nr < layer_count; layer_nr++)
+        {
+            not_air_windows.below[layer_nr] = std::move(windows[layer_nr - bottom_layer_count]); // the window ending at the layer below
+        }
+    }
+}
+
 void SkinInfillAreaComputation::calculateBottomSkin(const SliceLayerPart& part, int min_infill_area, Polygons& downskin)
 {
     if (static_cast<int>(layer_nr - bottom_layer_count) >= 0 && bottom_layer_count > 0)
     {
-        Polygons not_air = getWalls(part, layer_nr - bottom_layer_count, bottom_reference_wall_idx).offset(bottom_reference_wall_expansion);
-        if (!no_small_gaps_heuristic)
+        Polygons not_air;
+        if (!no_small_gaps_heuristic && not_air_windows && not_air_windows->has_below
+            && not_air_windows->bottom_reference_wall_idx == bottom_reference_wall_idx && not_air_windows->bottom_reference_wall_expansion == bottom_reference_wall_expansion
+            && hitsAllWalls(part, layer_nr - bottom_layer_count, layer_nr - 1, bottom_reference_wall_idx))
+        {
+            not_air = not_air_windows->below[layer_nr];
+        }
+        else
         {
-            for (int downskin_layer_nr = layer_nr - bottom_layer_count + 1; downskin_layer_nr < layer_nr; downskin_layer_nr++)
+            not_air = *getExpandedWalls(part, layer_nr - bottom_layer_count, bottom_reference_wall_idx, bottom_reference_wall_expansion);
+            if (!no_small_gaps_heuristic)
             {
-                not_air = not_air.intersection(getWalls(part, downskin_layer_nr, bottom_reference_wall_idx).offset(bottom_reference_wall_expansion));
+                for (int downskin_layer_nr = layer_nr - bottom_layer_count + 1; downskin_layer_nr < layer_nr; downskin_layer_nr++)
+                {
+                    not_air = not_air.intersection(*getExpandedWalls(part, downskin_layer_nr, bottom_reference_wall_idx, bottom_reference_wall_expansion));
+                }
             }
         }
         if (min_infill_area > 0)
@@ -263,12 +522,22 @@ void SkinInfillAreaComputation::calculateTopSkin(const SliceLayerPart& part, int
 {
     if (static_cast<int>(layer_nr + top_layer_count) < static_cast<int>(mesh.layers.size()) && top_layer_count > 0)
     {
-        Polygons not_air = getWalls(part, layer_nr + top_layer_count, top_reference_wall_idx).offset(top_reference_wall_expansion);
-        if (!no_small_gaps_heuristic)
+        Polygons not_air;
+        if (!no_small_gaps_heuristic && not_air_windows && not_air_windows->has_above
+            && not_air_windows->top_reference_wall_idx == top_reference_wall_idx && not_air_windows->top_reference_wall_expansion == top_reference_wall_expansion
+            && hitsAllWalls(part, layer_nr + 1, layer_nr + top_layer_count, top_reference_wall_idx))
+        {
+            not_air = not_air_windows->above[layer_nr];
+        }
+        else
         {
-            for (int upskin_layer_nr = layer_nr + 1; upskin_layer_nr < layer_nr + top_layer_count; upskin_layer_nr++)
+            not_air = *getExpandedWalls(part, layer_nr + top_layer_count, top_reference_wall_idx, top_reference_wall_expansion);
+            if (!no_small_gaps_heuristic)
             {
-                not_air = not_air.intersection(getWalls(part, upskin_layer_nr, top_reference_wall_idx).offset(top_reference_wall_expansion));
+                for (int upskin_layer_nr = layer_nr + 1; upskin_layer_nr < layer_nr + top_layer_count; upskin_layer_nr++)
+                {
+                    not_air = not_air.intersection(*getExpandedWalls(part, upskin_layer_nr, top_reference_wall_idx, top_reference_wall_expansion));
+                }
             }
         }
         if (min_infill_area > 0)
@@ -456,13 +725,12 @@ void SkinInfillAreaComputation::generateRoofing(SliceLayerPart& part)
         Polygons roofing;
         if (roofing_layer_count > 0)
         {
-            Polygons no_air_above = getWalls(part, layer_nr + roofing_layer_count, wall_idx);
+            Polygons no_air_above = *getExpandedWalls(part, layer_nr + roofing_layer_count, wall_idx, 0);
             if (!no_small_gaps_heuristic)
             {
                 for (int layer_nr_above = layer_nr + 1; layer_nr_above < layer_nr + roofing_layer_count; layer_nr_above++)
                 {
-                    Polygons outlines_above = getWalls(part, layer_nr_above, wall_idx);
-                    no_air_above = no_air_above.intersection(outlines_above);
+                    no_air_above = no_air_above.intersection(*getExpandedWalls(part, layer_nr_above, wall_idx, 0));
                 }
             }
             if (layer_nr > 0)
@@ -473,7 +741,7 @@ void SkinInfillAreaComputation::generateRoofing(SliceLayerPart& part)
                 // has air below (fixes https://github.com/Ultimaker/Cura/issues/2656)
 
                 // set air_below to the skin area for the current layer that has air below it
-                Polygons air_below = getWalls(part, layer_nr, wall_idx).difference(getWalls(part, layer_nr - 1, wall_idx));
+                Polygons air_below = getExpandedWalls(part, layer_nr, wall_idx, 0)->difference(*getExpandedWalls(part, layer_nr - 1, wall_idx, 0));
 
                 if (!air_below.empty())
                 {
@@ -584,7 +852,7 @@ void SkinInfillAreaComputation::generateGradualInfill(SliceMeshStorage& mesh, un
                         }
                         relevent_upper_polygons.add(upper_layer_part.getOwnInfillArea());
                     }
-                    less_dense_infill = less_dense_infill.intersection(relevent_upper_polygons);
+                    less_dense_infill = BoundedPolygonOps::intersection(less_dense_infill, relevent_upper_polygons);
                 }
                 if (less_dense_infill.size() == 0)
                 {
@@ -650,7 +918,7 @@ void SkinInfillAreaComputation::combineInfillLayers(SliceMeshStorage& mesh, unsi
                         if (part.boundaryBox.hit(lower_layer_part.boundaryBox))
                         {
 
-                            Polygons intersection = infill_area_per_combine[combine_count_here - 1].intersection(lower_layer_part.infill_area).offset(-200).offset(200);
+                            Polygons intersection = BoundedPolygonOps::intersection(infill_area_per_combine[combine_count_here - 1], lower_layer_part.infill_area).offset(-200).offset(200);
                             result.add(intersection); // add area to be thickened
                             infill_area_per_combine[combine_count_here - 1] = infill_area_per_combine[combine_count_here - 1].difference(intersection); // remove thickened area from less thick layer here
                             unsigned int max_lower_density_idx = density_idx;
@@ -2,11 +2,107 @@
 #ifndef SKIN_H
 #define SKIN_H
 
+#include <memory> // shared_ptr
+
 #include "sliceDataStorage.h"
+#include "utils/NoCopy.h"
 
 namespace cura 
 {
 
+/*!
+ * A cache of the walls which the skin computation gathers from the layers of a mesh.
+ *
+ * The skin of each layer is computed from the walls of up to top_layers + bottom_layers neighbouring layers,
+ * so without a cache the walls of every layer would be gathered and offset that many times.
+ *
+ * An entry is keyed on the layer, the wall index, the expansion and the parts of the layer from which the walls were gathered,
+ * so that a cached entry is exactly what would otherwise have been computed.
+ *
+ * The walls of a layer are evicted once the skin of every layer which reads them has been computed (see \ref finishLayer),
+ * so only the layers around those still being computed are kept.
+ *
+ * The cache may be used from multiple threads at once.
+ */
+class SkinWallsCache : NoCopy
+{
+public:
+    /*!
+     * \param mesh The mesh of which the walls are cached, to get the number of layers and the layers which the skin reads from
+     */
+    SkinWallsCache(const SliceMeshStorage& mesh);
+
+    /*!
+     * Get cached walls.
+     *
+     * \param layer_nr The layer from which the walls were gathered
+     * \param wall_idx The 1-based wall index of the walls. Zero means the outline.
+     * \param expansion The offset which was applied to the walls
+     * \param part_indices The indices of the parts in the layer from which the walls were gathered
+     * \return The walls, or nullptr if they aren't in the cache
+     */
+    std::shared_ptr<const Polygons> get(int layer_nr, unsigned int wall_idx, coord_t expansion, const std::vector<unsigned int>& part_indices) const;
+
+    /*!
+     * Add walls to the cache.
+     *
+     * If another thread has added the same walls in the meantime, the walls of that thread are kept.
+     *
+     * \param walls The walls gathered from the parts and offset by the expansion
+     * \return The cached walls
+     */
+    std::shared_ptr<const Polygons> insert(int layer_nr, unsigned int wall_idx, coord_t expansion, const std::vector<unsigned int>& part_indices, std::shared_ptr<const Polygons> walls);
+
+    /*!
+     * Record that the skin of a layer is computed, whether or not it was computed with this cache.
+     *
+     * The walls of the layers which no other layer still reads are evicted.
+     *
+     * \param layer_nr The layer of which the skin is computed
+     */
+    void finishLayer(int layer_nr);
+
+private:
+    struct Entry
+    {
+        unsigned int wall_idx;
+        coord_t expansion;
+        std::vector<unsigned int> part_indices;
+        std::shared_ptr<const Polygons> walls;
+    };
+
+    /*!
+     * Get the entry with the given key from a layer.
+     */
+    static const Entry* find(const std::vector<Entry>& entries, unsigned int wall_idx, coord_t expansion, const std::vector<unsigned int>& part_indices);
+
+    int layers_below; //!< The number of layers below a layer from which its skin reads walls
+    int layers_above; //!< The number of layers above a layer from which its skin reads walls
+    std::vector<std::vector<Entry>> entries_per_layer; //!< The cached walls of each layer
+    std::vector<int> unfinished_reader_count; //!< Per layer the number of layers which read its walls and aren't finished yet
+};
+
+/*!
+ * The areas which aren't air in the windows of layers above and below each layer of a mesh,
+ * i.e. the intersection of the reference walls of the top_layers layers above and of the bottom_layers layers below each layer.
+ *
+ * These are computed for all layers of a mesh at once (see SkinInfillAreaComputation::generateNotAirWindows)
+ * instead of by intersecting the walls of each window from scratch.
+ * Only used when the small gaps heuristic is disabled, since otherwise only a single layer is looked at.
+ */
+struct SkinNotAirWindows
+{
+    bool has_above = false; //!< Whether \ref above is computed
+    int top_reference_wall_idx = 0; //!< The reference wall from which \ref above is computed
+    coord_t top_reference_wall_expansion = 0; //!< The expansion of the reference walls from which \ref above is computed
+    std::vector<Polygons> above; //!< Per layer the area which isn't air in any of the top_layers layers above, if there are that many layers above
+
+    bool has_below = false; //!< Whether \ref below is computed
+    int bottom_reference_wall_idx = 0; //!< The reference wall from which \ref below is computed
+    coord_t bottom_reference_wall_expansion = 0; //!< The expansion of the reference walls from which \ref below is computed
+    std::vector<Polygons> below; //!< Per layer the area which isn't air in any of the bottom_layers layers below, if there are that many layers below
+};
+
 /*!
  * Class containing all skin and infill area computation functions
  */
@@ -20,14 +116,37 @@ public:
      * \param layer_nr The index of the layer for which to generate the skins and infill.
      * \param mesh The storage where the layer outline information (input) is stored and where the skin insets and fill areas (output) are stored.
      * \param process_infill Whether to process infill, i.e. whether there's a positive infill density or there are infill meshes modifying this mesh.
+     * \param walls_cache The cache of the walls gathered from the layers of \p mesh, shared by the computations of all layers, or nullptr to not cache the walls.
+     * \param not_air_windows The precomputed areas which aren't air above and below each layer of \p mesh, or nullptr to compute them per layer.
      */
-    SkinInfillAreaComputation(int layer_nr, const SliceDataStorage& storage, SliceMeshStorage& mesh, bool process_infill);
+    SkinInfillAreaComputation(int layer_nr, const SliceDataStorage& storage, SliceMeshStorage& mesh, bool process_infill, SkinWallsCache* walls_cache = nullptr, const SkinNotAirWindows* not_air_windows = nullptr);
 
     /*!
      * Generate the skin areas and its insets.
      */
     void generateSkinsAndInfill();
 
+    /*!
+     * Compute the areas which aren't air above and below each layer of the mesh at once.
+     *
+     * The windows of neighbouring layers share all but one of their layers.
+     * The layers are split into blocks as long as a window and the intersections from each layer to both ends of its block are computed,
+     * so that every window is the intersection of one suffix and one prefix of two consecutive blocks.
+     * This takes about three intersections per layer regardless of the number of top and bottom layers,
+     * where intersecting each window from scratch takes as many intersections as there are layers in the window.
+     *
+     * The windows are computed with the reference walls of the layer of this computation;
+     * layers with other reference walls (e.g. the first layer with its different line widths) still intersect their windows from scratch.
+     *
+     * The windows are intersected from the walls of all parts of each layer, whereas per layer only the walls of the parts
+     * whose boundary box hits the part for which the skin is computed are used.
+     * A part therefore only uses a window if it hits all parts with walls in the layers of that window (see \ref hitsAllWalls),
+     * so that both gather the same walls; other parts intersect their windows from scratch.
+     *
+     * \param[out] not_air_windows The areas which aren't air above and below each layer
+     */
+    void generateNotAirWindows(SkinNotAirWindows& not_air_windows);
+
     /*!
      * \brief Combines the infill of multiple layers for a specified mesh.
      * 
@@ -161,6 +280,8 @@ protected:
     const int skin_inset_count; //!< The number of perimeters to surround the skin
     const bool no_small_gaps_heuristic; //!< A heuristic which assumes there will be no small gaps between bottom and top skin with a z size smaller than the skin size itself
     const bool process_infill; //!< Whether to process infill, i.e. whether there's a positive infill density or there are infill meshes modifying this mesh.
+    SkinWallsCache* walls_cache; //!< The cache of the walls gathered from the layers of the mesh, or nullptr
+    const SkinNotAirWindows* not_air_windows; //!< The precomputed areas which aren't air above and below each layer of the mesh, or nullptr
 
     coord_t top_reference_wall_expansion; //!< The horizontal expansion to apply to the top reference wall in order to shrink the top skin
     coord_t bottom_reference_wall_expansion; //!< The horizontal expansion to apply to the bottom reference wall in order to shrink the bottom skin
@@ -183,6 +304,30 @@ private:
      */
     Polygons getWalls(const SliceLayerPart& part_here, int layer2_nr, unsigned int wall_idx);
 
+    /*!
+     * Get the walls of each part which might intersect with \p part_here, offset by \p expansion.
+     *
+     * The result is the same as `getWalls(part_here, layer2_nr, wall_idx).offset(expansion)`, but is taken from
+     * the \ref walls_cache when another part or layer has requested the same walls before.
+     *
+     * \param part_here The part for which to check
+     * \param layer2_nr The layer index from which to gather the walls
+     * \param wall_idx The 1-based wall index for the walls to grab. e.g. the outermost walls or the second walls. Zero means the outline.
+     * \param expansion The offset to apply to the gathered walls
+     */
+    std::shared_ptr<const Polygons> getExpandedWalls(const SliceLayerPart& part_here, int layer2_nr, unsigned int wall_idx, coord_t expansion);
+
+    /*!
+     * Whether the boundary box of \p part_here hits those of all parts in a range of layers which have the wall \p wall_idx,
+     * i.e. whether \ref getWalls gathers the walls of all parts of each of those layers.
+     *
+     * \param part_here The part for which to check
+     * \param first_layer_nr The lowest layer to check
+     * \param last_layer_nr The highest layer to check
+     * \param wall_idx The 1-based wall index of the walls. Zero means the outline.
+     */
+    bool hitsAllWalls(const SliceLayerPart& part_here, int first_layer_nr, int last_layer_nr, unsigned int wall_idx) const;
+
     /*!
      * Get the wall index of the reference wall for either the top or bottom skin.
      * With larger user specified preshrink come lower reference wall indices.
@@ -11,6 +11,20 @@
 namespace cura
 {
 
+//! Keys of the settings which are looked up for every layer when checking which extruders are used.
+static const SettingKey alternate_extra_perimeter_key("alternate_extra_perimeter");
+static const SettingKey anti_overhang_mesh_key("anti_overhang_mesh");
+static const SettingKey fill_outline_gaps_key("fill_outline_gaps");
+static const SettingKey infill_extruder_nr_key("infill_extruder_nr");
+static const SettingKey infill_line_distance_key("infill_line_distance");
+static const SettingKey roofing_extruder_nr_key("roofing_extruder_nr");
+static const SettingKey skin_outline_count_key("skin_outline_count");
+static const SettingKey support_mesh_key("support_mesh");
+static const SettingKey top_bottom_extruder_nr_key("top_bottom_extruder_nr");
+static const SettingKey wall_0_extruder_nr_key("wall_0_extruder_nr");
+static const SettingKey wall_line_count_key("wall_line_count");
+static const SettingKey wall_x_extruder_nr_key("wall_x_extruder_nr");
+
 SupportStorage::SupportStorage()
 : generated(false)
 , layer_nr_max_filled_layer(-1)
@@ -70,6 +84,16 @@ void SliceLayer::getOutlines(Polygons& result, bool external_polys_only) const
     }
 }
 
+void SliceLayer::calculateBoundaryBox()
+{
+    boundaryBox = AABB();
+    for (const SliceLayerPart& part : parts)
+    {
+        boundaryBox.include(part.boundaryBox.min);
+        boundaryBox.include(part.boundaryBox.max);
+    }
+}
+
 void SliceLayer::getInnermostWalls(Polygons& layer_walls, int max_inset, const SliceMeshStorage& mesh) const
 {
     const coord_t half_line_width_0 = mesh.getSettingInMicrons("wall_line_width_0") / 2;
@@ -209,13 +233,13 @@ bool SliceMeshStorage::getExtruderIsUsed(int extruder_nr, int layer_nr) const
     {
         return false;
     }
-    if (getSettingBoolean("anti_overhang_mesh")
-        || getSettingBoolean("support_mesh"))
+    if (getSettingBoolean(anti_overhang_mesh_key)
+        || getSettingBoolean(support_mesh_key))
     { // object is not printed as object, but as support.
         return false;
     }
     const SliceLayer& layer = layers[layer_nr];
-    if (getSettingAsExtruderNr("wall_0_extruder_nr") == extruder_nr && (getSettingAsCount("wall_line_count") > 0 || getSettingAsCount("skin_outline_count") > 0))
+    if (getSettingAsExtruderNr(wall_0_extruder_nr_key) == extruder_nr && (getSettingAsCount(wall_line_count_key) > 0 || getSettingAsCount(skin_outline_count_key) > 0))
     {
         for (const SliceLayerPart& part : layer.parts)
         {
@@ -233,8 +257,8 @@ bool SliceMeshStorage::getExtruderIsUsed(int extruder_nr, int layer_nr) const
         }
     }
     if (getSettingAsFillPerimeterGapMode("fill_perimeter_gaps") != FillPerimeterGapMode::NOWHERE
-        && (getSettingAsCount("wall_line_count") > 0 || getSettingAsCount("skin_outline_count") > 0)
-        && getSettingAsExtruderNr("wall_0_extruder_nr") == extruder_nr)
+        && (getSettingAsCount(wall_line_count_key) > 0 || getSettingAsCount(skin_outline_count_key) > 0)
+        && getSettingAsExtruderNr(wall_0_extruder_nr_key) == extruder_nr)
     {
         for (const SliceLayerPart& part : layer.parts)
         {
@@ -251,9 +275,9 @@ bool SliceMeshStorage::getExtruderIsUsed(int extruder_nr, int layer_nr) const
             }
         }
     }
-    if (getSettingBoolean("fill_outline_gaps")
-        && getSettingAsCount("wall_line_count") > 0
-        && getSettingAsExtruderNr("wall_0_extruder_nr") == extruder_nr)
+    if (getSettingBoolean(fill_outline_gaps_key)
+        && getSettingAsCount(wall_line_count_key) > 0
+        && getSettingAsExtruderNr(wall_0_extruder_nr_key) == extruder_nr)
     {
         for (const SliceLayerPart& part : layer.parts)
         {
@@ -263,7 +287,7 @@ bool SliceMeshStorage::getExtruderIsUsed(int extruder_nr, int layer_nr) const
             }
         }
     }
-    if ((getSettingAsCount("wall_line_count") > 1 || getSettingBoolean("alternate_extra_perimeter")) && getSettingAsExtruderNr("wall_x_extruder_nr") == extruder_nr)
+    if ((getSettingAsCount(wall_line_count_key) > 1 || getSettingBoolean(alternate_extra_perimeter_key)) && getSettingAsExtruderNr(wall_x_extruder_nr_key) == extruder_nr)
     {
         for (const SliceLayerPart& part : layer.parts)
         {
@@ -273,7 +297,7 @@ bool SliceMeshStorage::getExtruderIsUsed(int extruder_nr, int layer_nr) const
             }
         }
     }
-    if (getSettingInMicrons("infill_line_distance") > 0 && getSettingAsExtruderNr("infill_extruder_nr") == extruder_nr)
+    if (getSettingInMicrons(infill_line_distance_key) > 0 && getSettingAsExtruderNr(infill_extruder_nr_key) == extruder_nr)
     {
         for (const SliceLayerPart& part : layer.parts)
         {
@@ -283,7 +307,7 @@ bool SliceMeshStorage::getExtruderIsUsed(int extruder_nr, int layer_nr) const
             }
         }
     }
-    if (getSettingAsExtruderNr("top_bottom_extruder_nr") == extruder_nr)
+    if (getSettingAsExtruderNr(top_bottom_extruder_nr_key) == extruder_nr)
     {
         for (const SliceLayerPart& part : layer.parts)
         {
@@ -296,7 +320,7 @@ bool SliceMeshStorage::getExtruderIsUsed(int extruder_nr, int layer_nr) const
             }
         }
     }
-    if (getSettingAsExtruderNr("roofing_extruder_nr") == extruder_nr)
+    if (getSettingAsExtruderNr(roofing_extruder_nr_key) == extruder_nr)
     {
         for (const SliceLayerPart& part : layer.parts)
         {
@@ -341,7 +365,8 @@ SliceDataStorage::SliceDataStorage(MeshGroup* meshgroup) : SettingsMessenger(mes
     retraction_config_per_extruder(initializeRetractionConfigs()),
     extruder_switch_retraction_config_per_extruder(initializeRetractionConfigs()),
     max_print_height_second_to_last_extruder(-1),
-    primeTower(*this)
+    primeTower(*this),
+    is_caching_layer_outlines(false)
 {
     Point3 machine_max(getSettingInMicrons("machine_width"), getSettingInMicrons("machine_depth"), getSettingInMicrons("machine_height"));
     Point3 machine_min(0, 0, 0);
@@ -355,6 +380,58 @@ SliceDataStorage::SliceDataStorage(MeshGroup* meshgroup) : SettingsMessenger(mes
 }
 
 Polygons SliceDataStorage::getLayerOutlines(int layer_nr, bool include_helper_parts, bool external_polys_only) const
+{
+    if (!is_caching_layer_outlines || layer_nr < 0 || layer_nr >= static_cast<int>(layer_outlines_cache.size()))
+    { // the raft and filler layers are cheap to compute
+        return computeLayerOutlines(layer_nr, include_helper_parts, external_polys_only);
+    }
+    std::shared_ptr<const Polygons> outlines;
+#pragma omp critical (layer_outlines_cache)
+    outlines = layer_outlines_cache[layer_nr].outlines[include_helper_parts][external_polys_only];
+    if (!outlines)
+    { // computed outside of the critical section, so that other layers can be computed at the same time
+        std::shared_ptr<const Polygons> computed_outlines = std::make_shared<const Polygons>(computeLayerOutlines(layer_nr, include_helper_parts, external_polys_only));
+#pragma omp critical (layer_outlines_cache)
+        {
+            std::shared_ptr<const Polygons>& cached_outlines = layer_outlines_cache[layer_nr].outlines[include_helper_parts][external_polys_only];
+            if (!cached_outlines)
+            { // otherwise another thread has computed the same outlines in the meantime
+                cached_outlines = computed_outlines;
+            }
+            outlines = cached_outlines;
+        }
+    }
+    return *outlines;
+}
+
+void SliceDataStorage::startCachingLayerOutlines()
+{
+    is_caching_layer_outlines = true;
+    layer_outlines_cache.assign(print_layer_count, CachedLayerOutlines());
+}
+
+void SliceDataStorage::stopCachingLayerOutlines()
+{
+    is_caching_layer_outlines = false;
+    std::vector<CachedLayerOutlines>().swap(layer_outlines_cache);
+}
+
+void SliceDataStorage::invalidateLayerOutlines(bool helper_parts_only)
+{
+    for (CachedLayerOutlines& cached_layer_outlines : layer_outlines_cache)
+    {
+        for (bool external_polys_only : {false, true})
+        {
+            cached_layer_outlines.outlines[true][external_polys_only].reset();
+            if (!helper_parts_only)
+            {
+                cached_layer_outlines.outlines[false][external_polys_only].reset();
+            }
+        }
+    }
+}
+
+Polygons SliceDataStorage::computeLayerOutlines(int layer_nr, bool include_helper_parts, bool external_polys_only) const
 {
     if (layer_nr < 0 && layer_nr < -Raft::getFillerLayerCount(*this))
     { // when processing raft
@@ -625,6 +702,19 @@ bool SliceDataStorage::getExtruderPrimeBlobEnabled(const unsigned int extruder_n
     return train->getSettingBoolean("prime_blob_enable");
 }
 
+void SliceDataStorage::freezeAllSettings()
+{
+    freezeSettings();
+    for (SliceMeshStorage& mesh : meshes)
+    {
+        mesh.freezeSettings();
+    }
+    for (unsigned int extruder_nr = 0; extruder_nr < meshgroup->getExtruderCount(); extruder_nr++)
+    {
+        meshgroup->getExtruderTrain(extruder_nr)->freezeSettings();
+    }
+}
+
 
 void SupportLayer::excludeAreasFromSupportInfillAreas(const Polygons& exclude_polygons, const AABB& exclude_polygons_boundary_box)
 {
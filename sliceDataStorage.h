@@ -4,6 +4,8 @@
 #ifndef SLICE_DATA_STORAGE_H
 #define SLICE_DATA_STORAGE_H
 
+#include <memory> // shared_ptr
+
 #include "utils/IntPoint.h"
 #include "utils/optional.h"
 #include "utils/polygon.h"
@@ -143,6 +145,7 @@ public:
     int printZ;     //!< The height at which this layer needs to be printed. Can differ from sliceZ due to the raft.
     int thickness;  //!< The thickness of this layer. Can be different when using variable layer heights.
     std::vector<SliceLayerPart> parts;  //!< An array of LayerParts which contain the actual data. The parts are printed one at a time to minimize travel outside of the 3D model.
+    AABB boundaryBox; //!< The boundary box of all \ref parts, used to quickly reject whole layers when looking for overlap with other areas. Computed when the parts are created; it isn't shrunk when the parts shrink later on.
     Polygons openPolyLines; //!< A list of lines which were never hooked up into a 2D polygon. (Currently unused in normal operation)
 
     /*!
@@ -177,6 +180,11 @@ public:
      */
     void getInnermostWalls(Polygons& result, int max_inset, const SliceMeshStorage& mesh) const;
 
+    /*!
+     * Compute \ref boundaryBox from the boundary boxes of the \ref parts.
+     */
+    void calculateBoundaryBox();
+
     ~SliceLayer();
 };
 
@@ -325,9 +333,32 @@ public:
      * \param layer_nr the index of the layer for which to get the outlines (negative layer numbers indicate the raft)
      * \param include_helper_parts whether to include support and prime tower
      * \param external_polys_only whether to disregard all hole polygons
+     *
+     * While the outlines are cached (see \ref startCachingLayerOutlines) the outlines of each layer are only computed once.
+     * Thread safe.
      */
     Polygons getLayerOutlines(int layer_nr, bool include_helper_parts, bool external_polys_only = false) const;
 
+    /*!
+     * Cache the outlines returned by \ref getLayerOutlines from now on, until \ref stopCachingLayerOutlines.
+     *
+     * The cached outlines must be invalidated with \ref invalidateLayerOutlines whenever the geometry they are made of changes.
+     */
+    void startCachingLayerOutlines();
+
+    /*!
+     * Drop the cached outlines and stop caching them.
+     */
+    void stopCachingLayerOutlines();
+
+    /*!
+     * Drop the cached outlines, because the geometry they are made of has changed.
+     *
+     * \param helper_parts_only Whether only the support or prime tower has changed,
+     * so that only the outlines which include the helper parts need to be dropped
+     */
+    void invalidateLayerOutlines(bool helper_parts_only = false);
+
     /*!
      * Collects the second wall of every part, or the outer wall if it has no second, or the outline, if it has no outer wall.
      * 
@@ -362,11 +393,36 @@ public:
      */
     bool getExtruderPrimeBlobEnabled(const unsigned int extruder_nr) const;
 
+    /*!
+     * Freeze the resolved settings of this storage, of all meshes and of all
+     * extruder trains, so that worker threads can read them without walking
+     * the inheritance chains. See \ref SettingsBaseVirtual::freezeSettings
+     *
+     * Must be called before the settings are read from parallel regions.
+     */
+    void freezeAllSettings();
+
 private:
+    /*!
+     * The cached outlines of a layer, indexed by include_helper_parts and external_polys_only. See \ref getLayerOutlines
+     */
+    struct CachedLayerOutlines
+    {
+        std::shared_ptr<const Polygons> outlines[2][2];
+    };
+
+    bool is_caching_layer_outlines; //!< Whether \ref getLayerOutlines caches the outlines
+    mutable std::vector<CachedLayerOutlines> layer_outlines_cache; //!< The outlines cached by \ref getLayerOutlines per layer
+
     /*!
      * Construct the retraction_config_per_extruder
      */
     std::vector<RetractionConfig> initializeRetractionConfigs();
+
+    /*!
+     * Compute the outlines of a layer from scratch. See \ref getLayerOutlines
+     */
+    Polygons computeLayerOutlines(int layer_nr, bool include_helper_parts, bool external_polys_only) const;
 };
 
 }//namespace cura
@@ -2,7 +2,11 @@
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 #include <stdio.h>
 
-#include <algorithm> // remove_if
+#include <algorithm> // remove_if, lower_bound
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif // _OPENMP
 
 #include "utils/gettime.h"
 #include "utils/logoutput.h"
@@ -17,20 +21,45 @@ int largest_neglected_gap_first_phase = MM2INT(0.01); //!< distance between two
 int largest_neglected_gap_second_phase = MM2INT(0.02); //!< distance between two line segments regarded as connected
 int max_stitch1 = MM2INT(10.0); //!< maximal distance stitched between open polylines to form polygons
 
-void SlicerLayer::makeBasicPolygonLoops(Polygons& open_polylines)
+void SlicerLayer::buildFaceToSegmentIndex()
+{
+    segment_face_indices.resize(segments.size());
+    for (unsigned int segment_idx = 0; segment_idx < segments.size(); segment_idx++)
+    {
+        segment_face_indices[segment_idx] = segments[segment_idx].faceIndex;
+    }
+    assert(std::is_sorted(segment_face_indices.begin(), segment_face_indices.end()) && "Segments should be ordered by face index!");
+}
+
+int SlicerLayer::getSegmentIdxOfFace(int face_idx) const
 {
+    const std::vector<int>::const_iterator it = std::lower_bound(segment_face_indices.begin(), segment_face_indices.end(), face_idx);
+    if (it == segment_face_indices.end() || *it != face_idx)
+    {
+        return -1;
+    }
+    return it - segment_face_indices.begin();
+}
+
+void SlicerLayer::makeBasicPolygonLoops(const Mesh* mesh, Polygons& open_polylines)
+{
+    buildFaceToSegmentIndex();
+
     for(unsigned int start_segment_idx = 0; start_segment_idx < segments.size(); start_segment_idx++)
     {
         if (!segments[start_segment_idx].addedToPolygon)
         {
-            makeBasicPolygonLoop(open_polylines, start_segment_idx);
+            makeBasicPolygonLoop(mesh, open_polylines, start_segment_idx);
         }
     }
     //Clear the segmentList to save memory, it is no longer needed after this point.
     segments.clear();
+    segments.shrink_to_fit();
+    segment_face_indices.clear();
+    segment_face_indices.shrink_to_fit();
 }
 
-void SlicerLayer::makeBasicPolygonLoop(Polygons& open_polylines, unsigned int start_segment_idx)
+void SlicerLayer::makeBasicPolygonLoop(const Mesh* mesh, Polygons& open_polylines, unsigned int start_segment_idx)
 {
 
     Polygon poly;
@@ -41,7 +70,7 @@ void SlicerLayer::makeBasicPolygonLoop(Polygons& open_polylines, unsigned int st
         SlicerSegment& segment = segments[segment_idx];
         poly.add(segment.end);
         segment.addedToPolygon = true;
-        segment_idx = getNextSegmentIdx(segment, start_segment_idx);
+        segment_idx = getNextSegmentIdx(mesh, segment, start_segment_idx);
         if (segment_idx == static_cast<int>(start_segment_idx))
         { // polyon is closed
             polygons.add(poly);
@@ -54,12 +83,9 @@ void SlicerLayer::makeBasicPolygonLoop(Polygons& open_polylines, unsigned int st
 
 int SlicerLayer::tryFaceNextSegmentIdx(const SlicerSegment& segment, int face_idx, unsigned int start_segment_idx) const
 {
-    decltype(face_idx_to_segment_idx.begin()) it;
-    auto it_end = face_idx_to_segment_idx.end();
-    it = face_idx_to_segment_idx.find(face_idx);
-    if (it != it_end)
+    int segment_idx = getSegmentIdxOfFace(face_idx);
+    if (segment_idx != -1)
     {
-        int segment_idx = (*it).second;
         Point p1 = segments[segment_idx].start;
         Point diff = segment.end - p1;
         if (shorterThen(diff, largest_neglected_gap_first_phase))
@@ -79,11 +105,11 @@ int SlicerLayer::tryFaceNextSegmentIdx(const SlicerSegment& segment, int face_id
     return -1;
 }
 
-int SlicerLayer::getNextSegmentIdx(const SlicerSegment& segment, unsigned int start_segment_idx)
+int SlicerLayer::getNextSegmentIdx(const Mesh* mesh, const SlicerSegment& segment, unsigned int start_segment_idx)
 {
     int next_segment_idx = -1;
 
-    bool segment_ended_at_edge = segment.endVertex == nullptr;
+    bool segment_ended_at_edge = segment.endVertexIdx == -1;
     if (segment_ended_at_edge)
     {
         int face_to_try = segment.endOtherFaceIdx;
@@ -97,8 +123,7 @@ int SlicerLayer::getNextSegmentIdx(const SlicerSegment& segment, unsigned int st
     {
         // segment ended at vertex
 
-        const std::vector<uint32_t> &faces_to_try = segment.endVertex->connected_faces;
-        for (int face_to_try : faces_to_try)
+        for (int face_to_try : mesh->getConnectedFaces(segment.endVertexIdx))
         {
             int result_segment_idx =
                 tryFaceNextSegmentIdx(segment, face_to_try, start_segment_idx);
@@ -739,7 +764,7 @@ void SlicerLayer::makePolygons(const Mesh* mesh, bool keep_none_closed, bool ext
 {
     Polygons open_polylines;
 
-    makeBasicPolygonLoops(open_polylines);
+    makeBasicPolygonLoops(mesh, open_polylines);
 
     connectOpenPolylines(open_polylines);
 
@@ -795,6 +820,146 @@ void SlicerLayer::makePolygons(const Mesh* mesh, bool keep_none_closed, bool ext
     }
 }
 
+void Slicer::buildSegments()
+{
+    // The faces are divided into contiguous chunks which are intersected independently, each into its own buffer.
+    // Appending the buffers to the layers in chunk order afterwards yields exactly the segment order of a serial run,
+    // i.e. the segments of each layer are ordered by face index.
+    int chunk_count = 1;
+#ifdef _OPENMP
+    chunk_count = omp_get_max_threads() * 4; // more chunks than threads to balance the load between tall and flat faces
+#endif // _OPENMP
+    int face_count = mesh->faces.size();
+    chunk_count = std::max(1, std::min(chunk_count, face_count / 1024)); // don't bother the threads with tiny chunks
+    std::vector<std::vector<std::pair<size_t, SlicerSegment>>> chunk_segments(chunk_count); // per chunk: the layer index and the segment itself
+
+#pragma omp parallel for default(none) shared(chunk_segments) firstprivate(chunk_count, face_count) schedule(dynamic)
+    for (int chunk_idx = 0; chunk_idx < chunk_count; chunk_idx++)
+    {
+        std::vector<std::pair<size_t, SlicerSegment>>& segments = chunk_segments[chunk_idx];
+        const int face_idx_start = static_cast<int64_t>(face_count) * chunk_idx / chunk_count;
+        const int face_idx_end = static_cast<int64_t>(face_count) * (chunk_idx + 1) / chunk_count;
+        for (int face_idx = face_idx_start; face_idx < face_idx_end; face_idx++)
+        {
+            size_t layer_idx_start;
+            size_t layer_idx_end;
+            getFaceLayerRange(face_idx, layer_idx_start, layer_idx_end);
+
+            // calculate all intersections between a layer plane and a triangle
+            for (size_t layer_nr = layer_idx_start; layer_nr < layer_idx_end; layer_nr++)
+            {
+                SlicerSegment s;
+                if (sliceFace(face_idx, layers[layer_nr].z, s))
+                {
+                    segments.emplace_back(layer_nr, s);
+                }
+            }
+        }
+    }
+
+    // store the segments per layer
+    for (std::vector<std::pair<size_t, SlicerSegment>>& segments : chunk_segments)
+    {
+        for (const std::pair<size_t, SlicerSegment>& layer_segment : segments)
+        {
+            SlicerLayer& layer = layers[layer_segment.first];
+            layer.segments.push_back(layer_segment.second);
+        }
+        segments.clear();
+        segments.shrink_to_fit(); // release the buffer of this chunk as soon as it has been distributed
+    }
+}
+
+void Slicer::getFaceLayerRange(const unsigned int face_idx, size_t& layer_idx_start, size_t& layer_idx_end) const
+{
+    const MeshFace& face = mesh->faces[face_idx];
+    const int32_t z0 = mesh->vertices[face.vertex_index[0]].p.z;
+    const int32_t z1 = mesh->vertices[face.vertex_index[1]].p.z;
+    const int32_t z2 = mesh->vertices[face.vertex_index[2]].p.z;
+    const int32_t min_z = std::min(z0, std::min(z1, z2));
+    const int32_t max_z = std::max(z0, std::max(z1, z2));
+
+    // A plane through the lowest vertex only touches the face, so only layers strictly above it can generate a segment.
+    const std::vector<SlicerLayer>::const_iterator first = std::upper_bound(layers.begin(), layers.end(), min_z,
+        [](const int32_t z, const SlicerLayer& layer) { return z < layer.z; });
+    const std::vector<SlicerLayer>::const_iterator last = std::upper_bound(first, layers.end(), max_z,
+        [](const int32_t z, const SlicerLayer& layer) { return z < layer.z; });
+    layer_idx_start = first - layers.begin();
+    layer_idx_end = last - layers.begin();
+}
+
+bool Slicer::sliceFace(const unsigned int face_idx, const int32_t z, SlicerSegment& s) const
+{
+    // get all vertices per face
+    const MeshFace& face = mesh->faces[face_idx];
+    const MeshVertex& v0 = mesh->vertices[face.vertex_index[0]];
+    const MeshVertex& v1 = mesh->vertices[face.vertex_index[1]];
+    const MeshVertex& v2 = mesh->vertices[face.vertex_index[2]];
+
+    // get all vertices represented as 3D point
+    Point3 p0 = v0.p;
+    Point3 p1 = v1.p;
+    Point3 p2 = v2.p;
+
+    int end_vertex_idx = -1;
+    int end_edge_idx = -1;
+
+    if (p0.z < z && p1.z >= z && p2.z >= z)
+    {
+        s = project2D(p0, p2, p1, z);
+        end_edge_idx = 0;
+        if (p1.z == z)
+        {
+            end_vertex_idx = face.vertex_index[1];
+        }
+    }
+    else if (p0.z > z && p1.z < z && p2.z < z)
+    {
+        s = project2D(p0, p1, p2, z);
+        end_edge_idx = 2;
+    }
+    else if (p1.z < z && p0.z >= z && p2.z >= z)
+    {
+        s = project2D(p1, p0, p2, z);
+        end_edge_idx = 1;
+        if (p2.z == z)
+        {
+            end_vertex_idx = face.vertex_index[2];
+        }
+    }
+    else if (p1.z > z && p0.z < z && p2.z < z)
+    {
+        s = project2D(p1, p2, p0, z);
+        end_edge_idx = 0;
+    }
+    else if (p2.z < z && p1.z >= z && p0.z >= z)
+    {
+        s = project2D(p2, p1, p0, z);
+        end_edge_idx = 2;
+        if (p0.z == z)
+        {
+            end_vertex_idx = face.vertex_index[0];
+        }
+    }
+    else if (p2.z > z && p1.z < z && p0.z < z)
+    {
+        s = project2D(p2, p0, p1, z);
+        end_edge_idx = 1;
+    }
+    else
+    {
+        //Not all cases create a segment, because a point of a face could create just a dot, and two touching faces
+        //  on the slice would create two segments
+        return false;
+    }
+
+    s.endVertexIdx = end_vertex_idx;
+    s.faceIndex = face_idx;
+    s.endOtherFaceIdx = face.connected_face_index[end_edge_idx];
+    s.addedToPolygon = false;
+    return true;
+}
+
 Slicer::Slicer(Mesh* mesh, const coord_t initial_layer_thickness, const coord_t thickness, const size_t slice_layer_count, bool keep_none_closed, bool extensive_stitching,
                bool use_variable_layer_heights, std::vector<AdaptiveLayer>* adaptive_layers)
 : mesh(mesh)
@@ -827,96 +992,7 @@ Slicer::Slicer(Mesh* mesh, const coord_t initial_layer_thickness, const coord_t
         }
     }
 
-    // loop over all mesh faces
-    for (unsigned int mesh_idx = 0; mesh_idx < mesh->faces.size(); mesh_idx++)
-    {
-        // get all vertices per face
-        const MeshFace& face = mesh->faces[mesh_idx];
-        const MeshVertex& v0 = mesh->vertices[face.vertex_index[0]];
-        const MeshVertex& v1 = mesh->vertices[face.vertex_index[1]];
-        const MeshVertex& v2 = mesh->vertices[face.vertex_index[2]];
-
-        // get all vertices represented as 3D point
-        Point3 p0 = v0.p;
-        Point3 p1 = v1.p;
-        Point3 p2 = v2.p;
-
-        // find the minimum and maximum z point
-        int32_t minZ = p0.z;
-        int32_t maxZ = p0.z;
-        if (p1.z < minZ) minZ = p1.z;
-        if (p2.z < minZ) minZ = p2.z;
-        if (p1.z > maxZ) maxZ = p1.z;
-        if (p2.z > maxZ) maxZ = p2.z;
-
-        // calculate all intersections between a layer plane and a triangle
-        for (unsigned int layer_nr = 0; layer_nr < layers.size(); layer_nr++)
-        {
-            int32_t z = layers.at(layer_nr).z;
-
-            if (z < minZ) continue;
-
-            SlicerSegment s;
-            s.endVertex = nullptr;
-            int end_edge_idx = -1;
-
-            if (p0.z < z && p1.z >= z && p2.z >= z)
-            {
-                s = project2D(p0, p2, p1, z);
-                end_edge_idx = 0;
-                if (p1.z == z)
-                {
-                    s.endVertex = &v1;
-                }
-            }
-            else if (p0.z > z && p1.z < z && p2.z < z)
-            {
-                s = project2D(p0, p1, p2, z);
-                end_edge_idx = 2;
-            }
-            else if (p1.z < z && p0.z >= z && p2.z >= z)
-            {
-                s = project2D(p1, p0, p2, z);
-                end_edge_idx = 1;
-                if (p2.z == z)
-                {
-                    s.endVertex = &v2;
-                }
-            }
-            else if (p1.z > z && p0.z < z && p2.z < z)
-            {
-                s = project2D(p1, p2, p0, z);
-                end_edge_idx = 0;
-            }
-            else if (p2.z < z && p1.z >= z && p0.z >= z)
-            {
-                s = project2D(p2, p1, p0, z);
-                end_edge_idx = 2;
-                if (p0.z == z)
-                {
-                    s.endVertex = &v0;
-                }
-            }
-            else if (p2.z > z && p1.z < z && p0.z < z)
-            {
-                s = project2D(p2, p0, p1, z);
-                end_edge_idx = 1;
-            }
-            else
-            {
-                //Not all cases create a segment, because a point of a face could create just a dot, and two touching faces
-                //  on the slice would create two segments
-                continue;
-            }
-
-            // store the segments per layer
-            layers[layer_nr].face_idx_to_segment_idx.insert(std::make_pair(mesh_idx, layers[layer_nr].segments.size()));
-            s.faceIndex = mesh_idx;
-            s.endOtherFaceIdx = face.connected_face_index[end_edge_idx];
-            s.addedToPolygon = false;
-            layers[layer_nr].segments.push_back(s);
-        }
-    }
+    buildSegments();
 
     log("slice of mesh took %.3f seconds\n",slice_timer.restart());
 
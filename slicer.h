@@ -22,8 +22,8 @@ public:
     // The index of the other face connected via the edge that created end
     int endOtherFaceIdx = -1;
     // If end corresponds to a vertex of the mesh, then this is populated
-    // with the vertex that it ended on.
-    const MeshVertex *endVertex = nullptr;
+    // with the index of the vertex that it ended on.
+    int endVertexIdx = -1;
     bool addedToPolygon = false;
 };
 
@@ -48,8 +48,8 @@ public:
 class SlicerLayer
 {
 public:
-    std::vector<SlicerSegment> segments;
-    std::unordered_map<int, int> face_idx_to_segment_idx; // topology
+    std::vector<SlicerSegment> segments; //!< The segments of this layer, ordered by face index
+    std::vector<int> segment_face_indices; //!< The face index of each of the \ref segments, used to find the segment generated by a face (topology)
 
     int z = -1;
     Polygons polygons;
@@ -66,30 +66,49 @@ public:
     void makePolygons(const Mesh* mesh, bool keep_none_closed, bool extensive_stitching, bool is_initial_layer);
 
 protected:
+    /*!
+     * Fill \ref segment_face_indices from the \ref segments in a single pass.
+     *
+     * Because a face generates at most one segment per layer and the segments are ordered by face index,
+     * this gives a compact sorted index from face to segment.
+     */
+    void buildFaceToSegmentIndex();
+
+    /*!
+     * Get the index of the segment generated by the face with index \p face_idx.
+     *
+     * \param face_idx The index of the face in the mesh
+     * \return The index into \ref segments, or -1 if the face didn't generate a segment in this layer
+     */
+    int getSegmentIdxOfFace(int face_idx) const;
+
     /*!
      * Connect the segments into loops which correctly form polygons (don't perform stitching here)
      *
+     * \param[in] mesh The mesh which was sliced, used to find the faces connected to a vertex
      * \param[in,out] open_polylines The polylines which are stiched, but couldn't be closed into a loop
      */
-    void makeBasicPolygonLoops(Polygons& open_polylines);
+    void makeBasicPolygonLoops(const Mesh* mesh, Polygons& open_polylines);
 
     /*!
      * Connect the segments into a loop, starting from the segment with index \p start_segment_idx
      *
+     * \param[in] mesh The mesh which was sliced
      * \param[in,out] open_polylines The polylines which are stiched, but couldn't be closed into a loop
      * \param[in] start_segment_idx The index into SlicerLayer::segments for the first segment from which to start the polygon loop
      */
-    void makeBasicPolygonLoop(Polygons& open_polylines, unsigned int start_segment_idx);
+    void makeBasicPolygonLoop(const Mesh* mesh, Polygons& open_polylines, unsigned int start_segment_idx);
 
     /*!
      * Get the next segment connected to the end of \p segment.
      * Used to make closed polygon loops.
      * Return ASAP if segment is (also) connected to SlicerLayer::segments[\p start_segment_idx]
      *
+     * \param[in] mesh The mesh which was sliced, used to find the faces connected to the vertex at which \p segment ends
      * \param[in] segment The segment from which to start looking for the next
      * \param[in] start_segment_idx The index to the segment which when conected to \p segment will immediately stop looking for further candidates.
      */
-    int getNextSegmentIdx(const SlicerSegment& segment, unsigned int start_segment_idx);
+    int getNextSegmentIdx(const Mesh* mesh, const SlicerSegment& segment, unsigned int start_segment_idx);
 
     /*!
      * Connecting polygons that are not closed yet, as models are not always perfect manifold we need to join some stuff up to get proper polygons.
@@ -519,6 +538,38 @@ public:
     }
 
     void dumpSegmentsToHTML(const char* filename);
+
+protected:
+    /*!
+     * Intersect all faces of the mesh with the layer planes and store the resulting segments in SlicerLayer::segments.
+     *
+     * Each face only visits the layers between its lowest and its highest vertex.
+     * The first of those layers is found by a binary search on SlicerLayer::z,
+     * which requires the layers to be ordered by increasing z, as is the case for adaptive layers as well.
+     *
+     * The faces are intersected in parallel, but the segments of each layer end up ordered by face index,
+     * just like when slicing on a single thread, so that the result doesn't depend on the number of threads.
+     */
+    void buildSegments();
+
+    /*!
+     * Get the range of layers of which the plane could intersect the face with index \p face_idx.
+     *
+     * \param face_idx The index of the face in Mesh::faces
+     * \param[out] layer_idx_start The first layer which could intersect the face
+     * \param[out] layer_idx_end One past the last layer which could intersect the face
+     */
+    void getFaceLayerRange(const unsigned int face_idx, size_t& layer_idx_start, size_t& layer_idx_end) const;
+
+    /*!
+     * Compute the segment where the face with index \p face_idx intersects the horizontal plane at height \p z.
+     *
+     * \param face_idx The index of the face in Mesh::faces
+     * \param z The height of the slicing plane
+     * \param[out] segment The resulting segment
+     * \return Whether the face crosses the plane, i.e. whether \p segment was filled in
+     */
+    bool sliceFace(const unsigned int face_idx, const int32_t z, SlicerSegment& segment) const;
 };
 
 }//namespace cura
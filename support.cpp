@@ -14,6 +14,7 @@
 #include "support.h"
 
 #include "utils/math.h"
+#include "utils/BoundedPolygonOps.h"
 #include "progress/Progress.h"
 #include "infill/ImageBasedDensityProvider.h"
 #include "infill/UniformDensityProvider.h"
@@ -849,8 +850,12 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
             {
                 //Compute the areas that are too close to the model.
                 Polygons xy_overhang_disallowed = mesh.overhang_areas[layer_idx].offset(z_distance_top * tan_angle);
-                Polygons xy_non_overhang_disallowed = outlines.difference(mesh.overhang_areas[layer_idx].offset(xy_distance)).offset(xy_distance);
-                xy_disallowed_per_layer[layer_idx] = xy_overhang_disallowed.unionPolygons(xy_non_overhang_disallowed.unionPolygons(outlines.offset(xy_distance_overhang)));
+                Polygons xy_non_overhang_disallowed = BoundedPolygonOps::difference(outlines, mesh.overhang_areas[layer_idx].offset(xy_distance)).offset(xy_distance);
+                xy_disallowed_per_layer[layer_idx] = xy_non_overhang_disallowed.unionPolygons(outlines.offset(xy_distance_overhang));
+                if (!xy_overhang_disallowed.empty())
+                {
+                    xy_disallowed_per_layer[layer_idx] = xy_overhang_disallowed.unionPolygons(xy_disallowed_per_layer[layer_idx]);
+                }
             }
         }
         if (is_support_mesh_place_holder || !use_xy_distance_overhang)
@@ -0,0 +1,49 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "BoundedPolygonOps.h"
+
+namespace cura
+{
+
+Polygons BoundedPolygonOps::intersection(const Polygons& subject, const AABB& subject_box, const Polygons& clip, const AABB& clip_box)
+{
+    if (subject.empty() || clip.empty() || !subject_box.hit(clip_box))
+    {
+        return Polygons();
+    }
+    return subject.intersection(clip);
+}
+
+Polygons BoundedPolygonOps::intersection(const Polygons& subject, const Polygons& clip)
+{
+    if (subject.empty() || clip.empty())
+    {
+        return Polygons();
+    }
+    return intersection(subject, AABB(subject), clip, AABB(clip));
+}
+
+Polygons BoundedPolygonOps::difference(const Polygons& subject, const AABB& subject_box, const Polygons& clip, const AABB& clip_box)
+{
+    if (subject.empty())
+    {
+        return Polygons();
+    }
+    if (clip.empty() || !subject_box.hit(clip_box))
+    {
+        return subject;
+    }
+    return subject.difference(clip);
+}
+
+Polygons BoundedPolygonOps::difference(const Polygons& subject, const Polygons& clip)
+{
+    if (subject.empty() || clip.empty())
+    {
+        return subject;
+    }
+    return difference(subject, AABB(subject), clip, AABB(clip));
+}
+
+} // namespace cura
@@ -0,0 +1,64 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_BOUNDED_POLYGON_OPS_H
+#define UTILS_BOUNDED_POLYGON_OPS_H
+
+#include "AABB.h"
+#include "polygon.h"
+
+namespace cura
+{
+
+/*!
+ * Boolean operations on polygons which first compare the boundary boxes of the operands.
+ *
+ * When the result is known from the boxes alone, e.g. because one of the operands is empty or because the operands are
+ * too far apart to overlap, the result is returned without setting up Clipper.
+ * Otherwise the operation is the same as the corresponding function of \ref Polygons.
+ *
+ * The boxes may be larger than the polygons (e.g. when cached before the polygons shrunk), but never smaller.
+ *
+ * A short-circuited result is the same area as Clipper would have produced, but the polygons aren't normalized:
+ * the vertices of an operand are returned as they were given.
+ */
+class BoundedPolygonOps
+{
+public:
+    /*!
+     * Get the area of \p subject which is inside \p clip
+     *
+     * \param subject The polygons to intersect
+     * \param subject_box The boundary box of \p subject
+     * \param clip The polygons to intersect with
+     * \param clip_box The boundary box of \p clip
+     * \return The intersection
+     */
+    static Polygons intersection(const Polygons& subject, const AABB& subject_box, const Polygons& clip, const AABB& clip_box);
+
+    /*!
+     * Get the area of \p subject which is inside \p clip, computing the boundary boxes on the fly.
+     */
+    static Polygons intersection(const Polygons& subject, const Polygons& clip);
+
+    /*!
+     * Get the area of \p subject which is outside \p clip
+     *
+     * \param subject The polygons to carve from
+     * \param subject_box The boundary box of \p subject
+     * \param clip The polygons to carve away
+     * \param clip_box The boundary box of \p clip
+     * \return The difference
+     */
+    static Polygons difference(const Polygons& subject, const AABB& subject_box, const Polygons& clip, const AABB& clip_box);
+
+    /*!
+     * Get the area of \p subject which is outside \p clip, computing the boundary boxes on the fly.
+     */
+    static Polygons difference(const Polygons& subject, const Polygons& clip);
+
+};
+
+} // namespace cura
+
+#endif // UTILS_BOUNDED_POLYGON_OPS_H
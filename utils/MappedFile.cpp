@@ -0,0 +1,126 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h> // open
+    #include <sys/mman.h> // mmap
+    #include <sys/stat.h> // fstat
+    #include <unistd.h> // close
+#endif // _WIN32
+
+namespace cura
+{
+
+MappedFile::MappedFile()
+: contents(nullptr)
+, file_size(0)
+#ifdef _WIN32
+, file_handle(INVALID_HANDLE_VALUE)
+, mapping_handle(nullptr)
+#endif // _WIN32
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char* filename, const Access access)
+{
+    close();
+    const DWORD access_flag = (access == Access::SEQUENTIAL) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+    file_handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, access_flag, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_handle, &size) || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_handle)
+    {
+        close();
+        return false;
+    }
+    contents = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (!contents)
+    {
+        close();
+        return false;
+    }
+    file_size = size.QuadPart;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (contents)
+    {
+        UnmapViewOfFile(contents);
+    }
+    if (mapping_handle)
+    {
+        CloseHandle(mapping_handle);
+    }
+    if (file_handle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file_handle);
+    }
+    contents = nullptr;
+    file_size = 0;
+    mapping_handle = nullptr;
+    file_handle = INVALID_HANDLE_VALUE;
+}
+
+#else // not _WIN32
+
+bool MappedFile::open(const char* filename, const Access access)
+{
+    close();
+    const int file_descriptor = ::open(filename, O_RDONLY);
+    if (file_descriptor < 0)
+    {
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size <= 0)
+    {
+        ::close(file_descriptor);
+        return false;
+    }
+    void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    ::close(file_descriptor); // the mapping stays valid after closing the file
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(mapping, file_stat.st_size, (access == Access::SEQUENTIAL) ? MADV_SEQUENTIAL : MADV_RANDOM);
+    contents = static_cast<const char*>(mapping);
+    file_size = file_stat.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (contents)
+    {
+        munmap(const_cast<char*>(contents), file_size);
+    }
+    contents = nullptr;
+    file_size = 0;
+}
+
+#endif // _WIN32
+
+} // namespace cura
@@ -0,0 +1,80 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_MAPPED_FILE_H
+#define UTILS_MAPPED_FILE_H
+
+#include <cstddef> // size_t
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * A read-only view on the contents of a whole file, mapped into memory.
+ *
+ * The operating system pages the contents in on demand, so that large files
+ * can be parsed without copying them into a buffer first.
+ * The mapping is released when this object is destroyed.
+ */
+class MappedFile : NoCopy
+{
+public:
+    /*!
+     * How the contents of a file are going to be read, so that the operating system can page them in accordingly.
+     */
+    enum class Access
+    {
+        SEQUENTIAL, //!< From start to end, e.g. when parsing, so that the pages ahead are read in advance
+        RANDOM //!< In any order, e.g. when looking up records, so that only the pages which are read are paged in
+    };
+
+    MappedFile(); //!< Construct an empty mapping; call \ref open to map a file
+
+    ~MappedFile(); //!< Releases the mapping
+
+    /*!
+     * Map the file with the given name into memory.
+     *
+     * \param filename The file to map
+     * \param access How the contents are going to be read
+     * \return Whether the file could be opened and mapped. Empty files can't be mapped.
+     */
+    bool open(const char* filename, Access access);
+
+    /*!
+     * Release the mapping, if any.
+     */
+    void close();
+
+    /*!
+     * Get the start of the file contents.
+     *
+     * \return The first byte of the file, or nullptr if no file is mapped
+     */
+    const char* data() const
+    {
+        return contents;
+    }
+
+    /*!
+     * Get the number of bytes in the file.
+     */
+    size_t size() const
+    {
+        return file_size;
+    }
+
+private:
+    const char* contents; //!< The start of the mapped file contents
+    size_t file_size; //!< The number of bytes mapped
+#ifdef _WIN32
+    void* file_handle; //!< The HANDLE of the opened file
+    void* mapping_handle; //!< The HANDLE of the file mapping object
+#endif // _WIN32
+};
+
+} // namespace cura
+
+#endif // UTILS_MAPPED_FILE_H
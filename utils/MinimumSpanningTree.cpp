@@ -1,153 +1,415 @@
-//Copyright (c) 2017 Ultimaker B.V.
+//Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For sort, unique and lower_bound.
+#include <cmath> //For sqrt.
+#include <limits> //For the distance to a sector without vertices.
+
 #include "MinimumSpanningTree.h"
+#include "UnionFind.h" //For Kruskal's algorithm.
 
 namespace cura
 {
 
-MinimumSpanningTree::MinimumSpanningTree(std::unordered_set<Point> vertices) : adjacency_graph(prim(vertices))
+/*!
+ * \brief Orders points by their X coordinate and then by their Y coordinate.
+ */
+static bool isLess(const Point& a, const Point& b)
 {
-    //Just copy over the fields.
+    return a.X < b.X || (a.X == b.X && a.Y < b.Y);
 }
 
-MinimumSpanningTree::Edge::Edge(const Point start, const Point end) : start(start), end(end)
+/*!
+ * \brief Finds in which 45 degree sector around a vertex another vertex lies.
+ *
+ * The sectors are counter-clockwise, starting at the positive X axis. Each
+ * sector includes its first boundary but not its second, so the angle between
+ * two vertices in the same sector is always less than 45 degrees.
+ *
+ * \param direction The direction from the vertex to the other vertex. Must not
+ * be zero.
+ * \return The index of the sector, from 0 to 7.
+ */
+static unsigned int getSector(const Point& direction)
 {
-    //Just copy over the fields.
+    const coord_t x = direction.X;
+    const coord_t y = direction.Y;
+    if (x > 0 && y >= 0)
+    {
+        return (y < x) ? 0 : 1;
+    }
+    if (x <= 0 && y > 0)
+    {
+        return (-x < y) ? 2 : 3;
+    }
+    if (x < 0 && y <= 0)
+    {
+        return (-y < -x) ? 4 : 5;
+    }
+    return (x < -y) ? 6 : 7;
 }
 
-int MinimumSpanningTree::Edge::length() const
+/*!
+ * \brief Scrambles the indices of the vertices of an edge into a number which
+ * looks random, but is the same every time.
+ *
+ * Edges of equal length are ordered by this number. If they'd be ordered by the
+ * indices of their vertices, the tree of a regular grid of vertices would
+ * become a comb of long parallel rows, which tree support merges slowly.
+ */
+static unsigned long long getTieBreak(const size_t start, const size_t end)
 {
-    return vSize2(start - end);
+    unsigned long long result = start * 0x9E3779B97F4A7C15ull + end * 0xC2B2AE3D27D4EB4Full;
+    result = (result ^ (result >> 30)) * 0xBF58476D1CE4E5B9ull;
+    result = (result ^ (result >> 27)) * 0x94D049BB133111EBull;
+    return result ^ (result >> 31);
 }
 
-const std::unordered_map<Point, std::vector<MinimumSpanningTree::Edge>> MinimumSpanningTree::prim(std::unordered_set<Point> vertices) const
+bool MinimumSpanningTree::Edge::operator<(const Edge& other) const
 {
-    std::unordered_map<Point, std::vector<Edge>> result;
-    if (vertices.empty())
+    if (length2 != other.length2)
+    {
+        return length2 < other.length2;
+    }
+    const unsigned long long tie_break = getTieBreak(start, end);
+    const unsigned long long other_tie_break = getTieBreak(other.start, other.end);
+    if (tie_break != other_tie_break)
     {
-        return result; //No vertices, so we can't create edges either.
+        return tie_break < other_tie_break;
     }
-    result.reserve(vertices.size());
-    std::vector<Point> vertices_list;
-    for (Point vertex : vertices)
+    if (start != other.start)
     {
-        vertices_list.push_back(vertex);
+        return start < other.start;
     }
+    return end < other.end;
+}
 
-    Point first_point = vertices_list[0];
-    result[first_point] = std::vector<MinimumSpanningTree::Edge>(); //Start with one vertex in the tree.
+bool MinimumSpanningTree::Edge::operator==(const Edge& other) const
+{
+    return start == other.start && end == other.end;
+}
 
-    if (vertices_list.size() == 1)
+MinimumSpanningTree::MinimumSpanningTree(std::unordered_set<Point> vertices)
+: sorted_vertices(vertices.begin(), vertices.end())
+{
+    std::sort(sorted_vertices.begin(), sorted_vertices.end(), isLess); //Independent of the order of the set, and allows finding the vertices back.
+    //Finding the candidate edges only pays off for larger trees. Small trees are faster to compute from all edges.
+    constexpr size_t prim_max_vertex_count = 600;
+    setAdjacency((sorted_vertices.size() <= prim_max_vertex_count) ? prim() : kruskal());
+}
+
+std::vector<MinimumSpanningTree::Edge> MinimumSpanningTree::candidateEdges() const
+{
+    std::vector<Edge> result;
+    const size_t vertex_count = sorted_vertices.size();
+    if (vertex_count < 2)
     {
-        return result; //If there's only one vertex, we can't go creating any edges.
+        return result;
     }
 
-    std::unordered_map<Point*, coord_t> smallest_distance; //The shortest distance to the current tree.
-    smallest_distance.reserve(vertices_list.size());
-    std::unordered_map<Point*, Point*> smallest_distance_to; //Which point the shortest distance goes towards.
-    smallest_distance_to.reserve(vertices_list.size());
-    for (size_t vertex_index = 0; vertex_index < vertices_list.size(); vertex_index++)
+    //Put the vertices in a grid with about one vertex per cell, stored contiguously cell after cell.
+    Point min = sorted_vertices[0];
+    Point max = sorted_vertices[0];
+    for (const Point& vertex : sorted_vertices)
+    {
+        min.Y = std::min(min.Y, vertex.Y);
+        max.Y = std::max(max.Y, vertex.Y);
+    }
+    min.X = sorted_vertices.front().X;
+    max.X = sorted_vertices.back().X;
+    const coord_t width = max.X - min.X;
+    const coord_t height = max.Y - min.Y;
+    //Limit the number of cells in each direction as well, for vertices which lie (nearly) on a line.
+    const coord_t cell_size = std::max(std::max((coord_t)std::sqrt((double)width * height / vertex_count), std::max(width, height) / (coord_t)vertex_count), (coord_t)1);
+    const size_t grid_width = width / cell_size + 1;
+    const size_t grid_height = height / cell_size + 1;
+    std::vector<size_t> cell_start(grid_width * grid_height + 1, 0); //For each cell, where its vertices start in cell_vertices.
+    std::vector<size_t> vertex_cell(vertex_count);
+    for (size_t vertex_index = 0; vertex_index < vertex_count; vertex_index++)
+    {
+        const Point relative = sorted_vertices[vertex_index] - min;
+        vertex_cell[vertex_index] = (relative.Y / cell_size) * grid_width + relative.X / cell_size;
+        cell_start[vertex_cell[vertex_index] + 1]++;
+    }
+    for (size_t cell = 0; cell < grid_width * grid_height; cell++)
+    {
+        cell_start[cell + 1] += cell_start[cell];
+    }
+    std::vector<size_t> cell_vertices(vertex_count);
     {
-        if (vertices_list[vertex_index] == first_point)
+        std::vector<size_t> cell_fill(cell_start.begin(), cell_start.end() - 1);
+        for (size_t vertex_index = 0; vertex_index < vertex_count; vertex_index++)
         {
-            continue;
+            cell_vertices[cell_fill[vertex_cell[vertex_index]]++] = vertex_index;
         }
-        smallest_distance[&vertices_list[vertex_index]] = vSize2(vertices_list[vertex_index] - first_point);
-        smallest_distance_to[&vertices_list[vertex_index]] = &vertices_list[0];
     }
 
-    while(result.size() < vertices_list.size()) //All of the vertices need to be in the tree at the end.
+    //For each vertex, search rings of cells around it until the closest vertex in each sector is known.
+    //A vertex in a sector is at least as far from the vertex along the primary axis of the sector as along its secondary axis.
+    //So of each ring, only the cells on the side in the primary direction, from the middle to the corner in the secondary direction, can hold vertices of the sector.
+    constexpr unsigned int sector_count = 8;
+    static const coord_t primary[sector_count][2] = {{1, 0}, {0, 1}, {0, 1}, {-1, 0}, {-1, 0}, {0, -1}, {0, -1}, {1, 0}};
+    static const coord_t secondary[sector_count][2] = {{0, 1}, {1, 0}, {-1, 0}, {0, 1}, {0, -1}, {-1, 0}, {1, 0}, {0, -1}};
+    result.reserve(vertex_count * 4);
+    for (size_t vertex_index = 0; vertex_index < vertex_count; vertex_index++)
     {
-        //Choose the closest vertex to connect to that is not yet in the tree.
-        //This search is O(V) right now, which can be made down to O(log(V)). This reduces the overall time complexity from O(V*V) to O(V*log(E)).
-        //However that requires an implementation of a heap that supports the decreaseKey operation, which is not in the std library.
-        //TODO: Implement this?
-        Point* closest_point = nullptr;
-        coord_t closest_distance = std::numeric_limits<coord_t>::max();
-        for(std::pair<Point*, coord_t> point_and_distance : smallest_distance)
+        const Point vertex = sorted_vertices[vertex_index];
+        const coord_t cell_x = vertex_cell[vertex_index] % grid_width;
+        const coord_t cell_y = vertex_cell[vertex_index] / grid_width;
+        //How far the bounding box and the grid extend from the vertex in a direction along the axes.
+        const auto getMargin = [&](const coord_t* direction)
+        {
+            return (direction[0] > 0) ? max.X - vertex.X : (direction[0] < 0) ? vertex.X - min.X : (direction[1] > 0) ? max.Y - vertex.Y : vertex.Y - min.Y;
+        };
+        const auto getCellCount = [&](const coord_t* direction)
+        {
+            return (direction[0] > 0) ? (coord_t)grid_width - 1 - cell_x : (direction[0] < 0) ? cell_x : (direction[1] > 0) ? (coord_t)grid_height - 1 - cell_y : cell_y;
+        };
+
+        Edge closest[sector_count]; //The edge to the closest vertex in each sector. Of vertices at equal distance, the one with the smallest edge.
+        std::fill(closest, closest + sector_count, Edge{std::numeric_limits<coord_t>::max(), vertex_count, vertex_count});
+        const auto visitCell = [&](const coord_t x, const coord_t y)
         {
-            if (point_and_distance.second < closest_distance) //This one's closer!
+            const size_t cell = y * grid_width + x;
+            for (size_t cell_vertex = cell_start[cell]; cell_vertex < cell_start[cell + 1]; cell_vertex++)
             {
-                closest_point = point_and_distance.first;
-                closest_distance = point_and_distance.second;
+                const size_t other_index = cell_vertices[cell_vertex];
+                if (other_index == vertex_index)
+                {
+                    continue;
+                }
+                const Point direction = sorted_vertices[other_index] - vertex;
+                const Edge edge{vSize2(direction), std::min(vertex_index, other_index), std::max(vertex_index, other_index)};
+                Edge& closest_in_sector = closest[getSector(direction)];
+                if (edge < closest_in_sector)
+                {
+                    closest_in_sector = edge;
+                }
             }
-        }
+        };
 
-        //Add this point to the graph and remove it from the candidates.
-        Point closest_point_local = *closest_point;
-        Point other_end = *smallest_distance_to[closest_point];
-        if (result.find(closest_point_local) == result.end())
+        bool is_open[sector_count]; //Whether the sector may still have a vertex closer than the closest one found so far.
+        for (unsigned int sector = 0; sector < sector_count; sector++)
         {
-            result[closest_point_local] = std::vector<Edge>();
+            //The odd sectors don't include the primary axis, so they only have vertices if the bounding box extends in their secondary direction.
+            is_open[sector] = getMargin(primary[sector]) > 0 && (sector % 2 == 0 || getMargin(secondary[sector]) > 0);
         }
-        result[closest_point_local].emplace_back(closest_point_local, other_end);
-        if (result.find(other_end) == result.end())
+        visitCell(cell_x, cell_y);
+        for (coord_t ring = 0; ; ring++)
         {
-            result[other_end] = std::vector<Edge>();
+            if (ring > 0)
+            {
+                for (unsigned int sector = 0; sector < sector_count; sector++)
+                {
+                    if (!is_open[sector] || ring > getCellCount(primary[sector]) + 1)
+                    {
+                        continue;
+                    }
+                    const coord_t* primary_direction = primary[sector];
+                    const coord_t* secondary_direction = secondary[sector];
+                    const coord_t secondary_cell_count = std::min(ring, getCellCount(secondary_direction));
+                    if (ring <= getCellCount(primary_direction))
+                    {
+                        for (coord_t offset = 0; offset <= secondary_cell_count; offset++)
+                        {
+                            visitCell(cell_x + primary_direction[0] * ring + secondary_direction[0] * offset, cell_y + primary_direction[1] * ring + secondary_direction[1] * offset);
+                        }
+                    }
+                    if (secondary_cell_count == ring) //Vertices just within the sector, in the corner of the ring.
+                    {
+                        visitCell(cell_x + primary_direction[0] * (ring - 1) + secondary_direction[0] * ring, cell_y + primary_direction[1] * (ring - 1) + secondary_direction[1] * ring);
+                    }
+                }
+            }
+
+            //Any vertex in the next rings is at least this far away, and a sector has no cells beyond the grid.
+            //A vertex at exactly this distance may still have a smaller edge, so the sector stays open for those.
+            const coord_t searched_distance = ring * cell_size;
+            bool is_any_open = false;
+            for (unsigned int sector = 0; sector < sector_count; sector++)
+            {
+                is_open[sector] &= closest[sector].length2 >= searched_distance * searched_distance && ring <= getCellCount(primary[sector]);
+                is_any_open |= is_open[sector];
+            }
+            if (!is_any_open)
+            {
+                break;
+            }
         }
-        result[other_end].emplace_back(other_end, closest_point_local);
-        smallest_distance.erase(closest_point); //Remove it so we don't check for these points again.
-        smallest_distance_to.erase(closest_point);
 
-        //Update the distances of all points that are not in the graph.
-        for (std::pair<Point*, coord_t> point_and_distance : smallest_distance)
+        for (unsigned int sector = 0; sector < sector_count; sector++)
         {
-            coord_t new_distance = vSize2(*closest_point - *point_and_distance.first);
-            if (new_distance < point_and_distance.second) //New point is closer.
+            if (closest[sector].start != vertex_count)
             {
-                smallest_distance[point_and_distance.first] = new_distance;
-                smallest_distance_to[point_and_distance.first] = closest_point;
+                result.push_back(closest[sector]);
             }
         }
     }
 
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end()); //Edges found from both of their vertices.
     return result;
 }
 
-const std::vector<Point> MinimumSpanningTree::adjacentNodes(Point node) const
+std::vector<MinimumSpanningTree::Edge> MinimumSpanningTree::prim() const
 {
-    std::vector<Point> result;
-    std::unordered_map<Point, std::vector<Edge>>::const_iterator adjacency_entry = adjacency_graph.find(node);
-    if (adjacency_entry != adjacency_graph.end())
+    const size_t vertex_count = sorted_vertices.size();
+    std::vector<Edge> result;
+    if (vertex_count < 2)
+    {
+        return result;
+    }
+    result.reserve(vertex_count - 1);
+    constexpr coord_t in_tree = -1;
+    std::vector<coord_t> smallest_distance2(vertex_count); //For each vertex, the squared distance to the tree, or in_tree if it's part of the tree.
+    std::vector<size_t> smallest_distance_to(vertex_count, 0); //For each vertex, to which vertex of the tree the distance is smallest.
+    std::vector<unsigned long long> tie_break(vertex_count); //For each vertex, the tie break of its shortest edge to the tree, to order edges of equal length.
+    const auto getShortestEdge = [&](const size_t vertex_index)
+    {
+        const size_t other_end = smallest_distance_to[vertex_index];
+        return Edge{smallest_distance2[vertex_index], std::min(vertex_index, other_end), std::max(vertex_index, other_end)};
+    };
+    //Whether the shortest edge of a vertex is smaller than that of another vertex with an edge of the same length.
+    const auto isSmallerTie = [&](const size_t vertex_index, const size_t other_index)
     {
-        for (const Edge edge : (*adjacency_entry).second)
+        return (tie_break[vertex_index] != tie_break[other_index]) ? tie_break[vertex_index] < tie_break[other_index] : getShortestEdge(vertex_index) < getShortestEdge(other_index);
+    };
+    smallest_distance2[0] = in_tree; //Start with the first vertex in the tree.
+    for (size_t vertex_index = 1; vertex_index < vertex_count; vertex_index++)
+    {
+        smallest_distance2[vertex_index] = vSize2(sorted_vertices[vertex_index] - sorted_vertices[0]);
+        tie_break[vertex_index] = getTieBreak(0, vertex_index);
+    }
+    while (result.size() < vertex_count - 1)
+    {
+        //Choose the closest vertex to connect to that is not yet in the tree. Of vertices at equal distance, the one with the smallest edge.
+        size_t closest = vertex_count;
+        for (size_t vertex_index = 0; vertex_index < vertex_count; vertex_index++)
         {
-            //Get the opposite side.
-            if (edge.start == node)
+            const coord_t distance2 = smallest_distance2[vertex_index];
+            if (distance2 != in_tree && (closest == vertex_count || distance2 < smallest_distance2[closest] || (distance2 == smallest_distance2[closest] && isSmallerTie(vertex_index, closest))))
             {
-                result.push_back(edge.end);
+                closest = vertex_index;
             }
-            else
+        }
+        result.push_back(getShortestEdge(closest));
+        smallest_distance2[closest] = in_tree;
+
+        //Update the distances of all vertices that are not in the tree.
+        for (size_t vertex_index = 0; vertex_index < vertex_count; vertex_index++)
+        {
+            if (smallest_distance2[vertex_index] == in_tree)
+            {
+                continue;
+            }
+            const coord_t distance2 = vSize2(sorted_vertices[vertex_index] - sorted_vertices[closest]);
+            if (distance2 > smallest_distance2[vertex_index])
             {
-                result.push_back(edge.start);
+                continue;
+            }
+            const Edge edge{distance2, std::min(vertex_index, closest), std::max(vertex_index, closest)};
+            if (distance2 < smallest_distance2[vertex_index] || edge < getShortestEdge(vertex_index))
+            {
+                smallest_distance2[vertex_index] = distance2;
+                smallest_distance_to[vertex_index] = closest;
+                tie_break[vertex_index] = getTieBreak(edge.start, edge.end);
             }
         }
     }
     return result;
 }
 
-std::vector<Point> MinimumSpanningTree::leaves() const
+std::vector<MinimumSpanningTree::Edge> MinimumSpanningTree::kruskal() const
 {
-    std::vector<Point> result;
-    for (std::pair<Point, std::vector<Edge>> node : adjacency_graph)
+    const size_t vertex_count = sorted_vertices.size();
+    std::vector<Edge> result;
+    if (vertex_count < 2)
+    {
+        return result;
+    }
+    result.reserve(vertex_count - 1);
+    UnionFind<size_t> trees; //The trees of the forest which Kruskal's algorithm joins together.
+    for (size_t vertex_index = 0; vertex_index < vertex_count; vertex_index++)
+    {
+        trees.add(vertex_index); //The handle of each vertex is its index.
+    }
+    for (const Edge& edge : candidateEdges())
     {
-        if (node.second.size() <= 1) //Leaves are nodes that have only one adjacent edge, or just the one node if the tree contains one node.
+        const size_t start_tree = trees.findByHandle(edge.start);
+        const size_t end_tree = trees.findByHandle(edge.end);
+        if (start_tree == end_tree)
         {
-            result.push_back(node.first);
+            continue; //Would create a cycle.
+        }
+        trees.unite(start_tree, end_tree);
+        result.push_back(edge);
+        if (result.size() == vertex_count - 1)
+        {
+            break; //All vertices are connected.
         }
     }
     return result;
 }
 
-std::vector<Point> MinimumSpanningTree::vertices() const
+void MinimumSpanningTree::setAdjacency(const std::vector<Edge>& tree_edges)
+{
+    const size_t vertex_count = sorted_vertices.size();
+    adjacency_start.assign(vertex_count + 1, 0);
+    for (const Edge& edge : tree_edges)
+    {
+        adjacency_start[edge.start + 1]++;
+        adjacency_start[edge.end + 1]++;
+    }
+    for (size_t vertex_index = 0; vertex_index < vertex_count; vertex_index++)
+    {
+        adjacency_start[vertex_index + 1] += adjacency_start[vertex_index];
+    }
+    adjacency.resize(tree_edges.size() * 2);
+    std::vector<size_t> adjacency_fill(adjacency_start.begin(), adjacency_start.end() - 1);
+    for (const Edge& edge : tree_edges)
+    {
+        adjacency[adjacency_fill[edge.start]++] = sorted_vertices[edge.end];
+        adjacency[adjacency_fill[edge.end]++] = sorted_vertices[edge.start];
+    }
+}
+
+size_t MinimumSpanningTree::findVertex(const Point& vertex) const
+{
+    const std::vector<Point>::const_iterator it = std::lower_bound(sorted_vertices.begin(), sorted_vertices.end(), vertex, isLess);
+    if (it == sorted_vertices.end() || *it != vertex)
+    {
+        return sorted_vertices.size();
+    }
+    return it - sorted_vertices.begin();
+}
+
+MinimumSpanningTree::AdjacentNodes MinimumSpanningTree::adjacentNodes(Point node) const
+{
+    const size_t vertex_index = findVertex(node);
+    if (vertex_index == sorted_vertices.size())
+    {
+        return AdjacentNodes(nullptr, nullptr);
+    }
+    const Point* adjacent = adjacency.data();
+    return AdjacentNodes(adjacent + adjacency_start[vertex_index], adjacent + adjacency_start[vertex_index + 1]);
+}
+
+std::vector<Point> MinimumSpanningTree::leaves() const
 {
     std::vector<Point> result;
-    for (std::pair<Point, std::vector<Edge>> node : adjacency_graph)
+    for (size_t vertex_index = 0; vertex_index < sorted_vertices.size(); vertex_index++)
     {
-        result.push_back(node.first);
+        if (adjacency_start[vertex_index + 1] - adjacency_start[vertex_index] <= 1) //Leaves are nodes that have only one adjacent edge, or just the one node if the tree contains one node.
+        {
+            result.push_back(sorted_vertices[vertex_index]);
+        }
     }
     return result;
 }
 
-}
\ No newline at end of file
+std::vector<Point> MinimumSpanningTree::vertices() const
+{
+    return sorted_vertices;
+}
+
+}
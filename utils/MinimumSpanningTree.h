@@ -5,7 +5,6 @@
 #define MINIMUMSPANNINGTREE_H
 
 #include <vector>
-#include <unordered_map>
 #include <unordered_set>
 
 #include "IntPoint.h"
@@ -14,53 +13,75 @@ namespace cura
 {
 
 /*!
- * \brief Implements Prim's algorithm to compute Minimum Spanning Trees (MST).
+ * \brief Computes the Minimum Spanning Tree (MST) of a set of points, where
+ * each edge weighs as much as its length.
  *
- * The minimum spanning tree is always computed from a clique of vertices.
+ * The minimum spanning tree is always computed from a clique of vertices, but
+ * only few of the edges of the clique can be part of it. Of all vertices in a
+ * 45 degree sector around a vertex, only the closest one can be connected to
+ * it: any other vertex in the sector is closer to that one than to the vertex
+ * itself. So Kruskal's algorithm only needs to consider the edges to the
+ * closest vertex in each of eight sectors around each vertex, which are found
+ * with a grid. Small trees are computed with Prim's algorithm on all edges of
+ * the clique instead, which has less overhead.
+ *
+ * Edges of equal length are ordered in a fixed, scrambled order, so the tree is
+ * the same for both algorithms and every time the same vertices are given.
  */
 class MinimumSpanningTree
 {
-    /*!
-     * \brief Represents an edge of the tree.
-     *
-     * While edges are meant to be undirected, these do have a start and end
-     * point.
-     */
-    struct Edge {
-        /**
-         * Constructs a new edge.
-         * @param start One endpoint of the edge.
-         * @param end The other endpoint of the edge.
-         */
-        Edge(const Point start, const Point end);
-
-        /**
-         * The point at which this edge starts.
-         */
-        const Point start;
-
-        /**
-         * The point at which this edge ends.
-         */
-        const Point end;
-
-        /**
-         * Computes the length of this edge.
-         * @return The length of this edge.
-         */
-        int length() const;
-    };
 public:
     /*!
      * \brief Constructs a minimum spanning tree that spans all given vertices.
      */
     MinimumSpanningTree(std::unordered_set<Point> vertices);
 
+    /*!
+     * \brief The nodes that are adjacent to a node, as a view on the storage
+     * of the tree, so that looking them up doesn't allocate anything.
+     *
+     * The view is valid as long as the tree exists.
+     */
+    class AdjacentNodes
+    {
+    public:
+        AdjacentNodes(const Point* first, const Point* last)
+        : first(first)
+        , last(last)
+        {
+        }
+
+        const Point* begin() const
+        {
+            return first;
+        }
+
+        const Point* end() const
+        {
+            return last;
+        }
+
+        size_t size() const
+        {
+            return last - first;
+        }
+
+        const Point& operator[](const size_t index) const
+        {
+            return first[index];
+        }
+
+    private:
+        const Point* first; //!< The first adjacent node
+        const Point* last; //!< Past the last adjacent node
+    };
+
     /*!
      * \brief Gets the nodes that are adjacent to the specified node.
-     * \return A list of nodes that are adjacent.
+     * \return The nodes that are adjacent, which is empty if the node is not
+     * part of the tree.
      */
-    const std::vector<Point> adjacentNodes(Point node) const;
+    AdjacentNodes adjacentNodes(Point node) const;
 
     /*!
      * \brief Gets the leaves of the tree.
@@ -75,16 +96,78 @@ public:
     std::vector<Point> vertices() const;
 
 private:
-    const std::unordered_map<Point, std::vector<Edge>> adjacency_graph;
+    /*!
+     * \brief Represents an edge of the tree, between two vertices.
+     */
+    struct Edge
+    {
+        coord_t length2; //!< The squared length of the edge
+        size_t start; //!< The index of the vertex with the lowest index
+        size_t end; //!< The index of the vertex with the highest index
+
+        /*!
+         * \brief Orders the edges by their length. Edges of equal length are
+         * ordered by a scrambled number, to connect a regular grid of vertices
+         * in an irregular way.
+         */
+        bool operator<(const Edge& other) const;
+        bool operator==(const Edge& other) const;
+    };
+
+    /*!
+     * \brief The vertices of the tree, sorted by their X and then their Y
+     * coordinate so that a vertex can be looked up by its position.
+     */
+    std::vector<Point> sorted_vertices;
+
+    /*!
+     * \brief For each vertex, where its adjacent vertices start in
+     * \ref adjacency, followed by the end of the last vertex.
+     */
+    std::vector<size_t> adjacency_start;
+
+    /*!
+     * \brief The adjacent vertices of all vertices, one vertex after the
+     * other.
+     */
+    std::vector<Point> adjacency;
+
+    /*!
+     * \brief Finds the candidate edges: the edges from each vertex to the
+     * closest vertex in each of the eight 45 degree sectors around it.
+     *
+     * \return The candidate edges, each edge once, shortest first.
+     */
+    std::vector<Edge> candidateEdges() const;
 
     /*!
      * \brief Computes the edges of a minimum spanning tree using Prim's
-     * algorithm.
+     * algorithm on all edges of the clique.
      *
-     * \param vertices The vertices to span.
-     * \return An adjacency graph with for each point one or more edges.
+     * This takes quadratic time, but has little overhead for small trees.
+     * \return The edges of the tree.
+     */
+    std::vector<Edge> prim() const;
+
+    /*!
+     * \brief Computes the edges of a minimum spanning tree using Kruskal's
+     * algorithm on the candidate edges.
+     * \return The edges of the tree.
+     */
+    std::vector<Edge> kruskal() const;
+
+    /*!
+     * \brief Stores the edges of the tree per vertex in \ref adjacency.
+     * \param tree_edges The edges of the tree.
+     */
+    void setAdjacency(const std::vector<Edge>& tree_edges);
+
+    /*!
+     * \brief Finds the index of a vertex in \ref sorted_vertices.
+     * \return The index of the vertex, or the number of vertices if it's not a
+     * vertex of the tree.
      */
-    const std::unordered_map<Point, std::vector<Edge>> prim(std::unordered_set<Point> vertices) const;
+    size_t findVertex(const Point& vertex) const;
 };
 
 }
@@ -0,0 +1,100 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "WavefrontScheduler.h"
+
+#include <algorithm> // min
+
+namespace cura
+{
+
+WavefrontScheduler::WavefrontScheduler(const unsigned int layer_count)
+: layer_count(layer_count)
+{
+}
+
+void WavefrontScheduler::addStage(const std::function<void (unsigned int)>& process_layer, const unsigned int layers_above)
+{
+    stages.emplace_back();
+    Stage& stage = stages.back();
+    stage.process_layer = process_layer;
+    stage.layers_above = layers_above;
+    stage.next_layer_nr = 0;
+    stage.done_layer_count = 0;
+    stage.is_done.assign(layer_count, false);
+}
+
+void WavefrontScheduler::run()
+{
+#pragma omp parallel default(none)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            unsigned int stage_idx;
+            unsigned int layer_nr;
+            if (!startNext(stage_idx, layer_nr))
+            {
+                if (isAllStarted())
+                {
+                    break;
+                }
+                layer_finished.wait(lock); // the layers which are ready are all being processed
+                continue;
+            }
+            lock.unlock();
+            stages[stage_idx].process_layer(layer_nr);
+            lock.lock();
+            finish(stage_idx, layer_nr);
+            layer_finished.notify_all(); // layers of the next stage may have become ready, or all layers may have been started
+        }
+    }
+}
+
+bool WavefrontScheduler::startNext(unsigned int& stage_idx, unsigned int& layer_nr)
+{
+    for (unsigned int stage_idx_here = stages.size(); stage_idx_here-- > 0; )
+    {
+        Stage& stage = stages[stage_idx_here];
+        if (stage.next_layer_nr >= layer_count)
+        {
+            continue;
+        }
+        if (stage_idx_here > 0)
+        {
+            const unsigned int last_required_layer_nr = std::min(stage.next_layer_nr + stage.layers_above, layer_count - 1);
+            if (stages[stage_idx_here - 1].done_layer_count <= last_required_layer_nr)
+            {
+                continue;
+            }
+        }
+        stage_idx = stage_idx_here;
+        layer_nr = stage.next_layer_nr++;
+        return true;
+    }
+    return false;
+}
+
+void WavefrontScheduler::finish(const unsigned int stage_idx, const unsigned int layer_nr)
+{
+    Stage& stage = stages[stage_idx];
+    stage.is_done[layer_nr] = true;
+    while (stage.done_layer_count < layer_count && stage.is_done[stage.done_layer_count])
+    {
+        stage.done_layer_count++;
+    }
+}
+
+bool WavefrontScheduler::isAllStarted() const
+{
+    for (const Stage& stage : stages)
+    {
+        if (stage.next_layer_nr < layer_count)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+}//namespace cura
@@ -0,0 +1,89 @@
+//Copyright (c) 2018 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_WAVEFRONT_SCHEDULER_H
+#define UTILS_WAVEFRONT_SCHEDULER_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * Runs several stages which each process every layer, where a layer of a stage only depends on a window of layers of the stage before it.
+ *
+ * Instead of finishing a stage for all layers before starting the next stage, each layer of a stage is processed as soon as the
+ * layers it depends on are done, so that the stages sweep up the layer stack together like a wavefront.
+ * The threads don't wait at the end of each stage for the slowest layer, and a layer is processed by all stages while its data is still warm.
+ *
+ * The layers of each stage are started in order. When several layers are ready, the layer of the latest stage is processed first,
+ * so that layers are finished as early as possible.
+ */
+class WavefrontScheduler : NoCopy
+{
+public:
+    /*!
+     * \param layer_count The number of layers which each stage processes
+     */
+    WavefrontScheduler(unsigned int layer_count);
+
+    /*!
+     * Add a stage after the stages added before.
+     *
+     * \param process_layer The function which processes a layer in this stage. It's called from multiple threads at once, for different layers.
+     * \param layers_above The number of layers above a layer which the previous stage must have processed before this stage processes the layer.
+     * The previous stage must have processed all of the layers below it as well.
+     */
+    void addStage(const std::function<void (unsigned int)>& process_layer, unsigned int layers_above);
+
+    /*!
+     * Process all layers in all stages, in parallel.
+     */
+    void run();
+
+private:
+    /*!
+     * A pass over all layers, and how far it got.
+     */
+    struct Stage
+    {
+        std::function<void (unsigned int)> process_layer; //!< Processes a layer
+        unsigned int layers_above; //!< The number of layers above a layer which the previous stage must have processed
+        unsigned int next_layer_nr; //!< The next layer to start
+        unsigned int done_layer_count; //!< The number of layers from the bottom up which are all done
+        std::vector<bool> is_done; //!< For each layer whether it is done
+    };
+
+    unsigned int layer_count; //!< The number of layers which each stage processes
+    std::vector<Stage> stages; //!< The stages in the order in which they process each layer
+    std::mutex mutex; //!< Guards the progress of the stages
+    std::condition_variable layer_finished; //!< Wakes the threads which wait for a layer to become ready
+
+    /*!
+     * Pick the next layer to process, if any is ready.
+     *
+     * \param[out] stage_idx The stage which is to process the layer
+     * \param[out] layer_nr The layer to process
+     * \return Whether a layer is ready to be processed
+     */
+    bool startNext(unsigned int& stage_idx, unsigned int& layer_nr);
+
+    /*!
+     * Register that a layer has been processed by a stage.
+     */
+    void finish(unsigned int stage_idx, unsigned int layer_nr);
+
+    /*!
+     * Whether every stage has started all of its layers.
+     */
+    bool isAllStarted() const;
+};
+
+}//namespace cura
+
+#endif//UTILS_WAVEFRONT_SCHEDULER_H
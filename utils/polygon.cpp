@@ -1167,14 +1167,36 @@ double Polygons::area() const
 
 std::vector<PolygonsPart> Polygons::splitIntoParts(bool unionAll) const
 {
-    std::vector<PolygonsPart> ret;
     ClipperLib::Clipper clipper(clipper_init);
     ClipperLib::PolyTree resultPolyTree;
+    return splitIntoParts(unionAll, clipper, resultPolyTree);
+}
+
+std::vector<PolygonsPart> Polygons::splitIntoParts(bool unionAll, ClipperLib::Clipper& clipper, ClipperLib::PolyTree& resultPolyTree) const
+{
+    std::vector<PolygonsPart> ret;
+    clipper.Clear();
+    resultPolyTree.Clear(); // not cleared by the clipper when there is nothing to unite
     clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-    if (unionAll)
-        clipper.Execute(ClipperLib::ctUnion, resultPolyTree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
-    else
-        clipper.Execute(ClipperLib::ctUnion, resultPolyTree);
+    const ClipperLib::PolyFillType fill_type = unionAll ? ClipperLib::pftNonZero : ClipperLib::pftEvenOdd;
+    if (paths.size() == 1)
+    { // a single polygon is nearly always a single part without holes, which doesn't need the hierarchy of a PolyTree
+        ClipperLib::Paths result;
+        clipper.Execute(ClipperLib::ctUnion, result, fill_type, fill_type);
+        // the PolyTree skips the same degenerate polygons
+        result.erase(std::remove_if(result.begin(), result.end(), [](const ClipperLib::Path& path) { return path.size() < 3; }), result.end());
+        if (result.size() <= 1)
+        {
+            if (result.size() == 1)
+            {
+                ret.emplace_back();
+                ret.back().paths = std::move(result);
+            }
+            return ret;
+        }
+        // the polygon intersects itself, so compute the hierarchy after all
+    }
+    clipper.Execute(ClipperLib::ctUnion, resultPolyTree, fill_type, fill_type);
 
     splitIntoParts_processPolyTreeNode(&resultPolyTree, ret);
     return ret;
@@ -927,6 +927,17 @@ public:
      * Each PolygonsPart in the result has an outline as first polygon, whereas the rest are holes.
      */
     std::vector<PolygonsPart> splitIntoParts(bool unionAll = false) const;
+
+    /*!
+     * Split up the polygons into groups according to the even-odd rule, reusing the Clipper objects of an earlier split.
+     *
+     * Creating and destroying the Clipper objects for each split adds up when splitting many polygons, e.g. all layers of a mesh.
+     *
+     * \param unionAll Whether to unite all polygons using the non-zero fill rule, rather than the even-odd rule
+     * \param clipper The clipper to use, which is cleared first
+     * \param poly_tree The poly tree in which to store the result of the union
+     */
+    std::vector<PolygonsPart> splitIntoParts(bool unionAll, ClipperLib::Clipper& clipper, ClipperLib::PolyTree& poly_tree) const;
 private:
     /*!
      * recursive part of \ref Polygons::removeEmptyHoles and \ref Polygons::getEmptyHoles